@@ -8,3 +8,8 @@ DEVLIB_INCLUDE_EXAMPLES {
    SUBDIRS += examples
    examples.depends = devlib
 }
+
+DEVLIB_INCLUDE_TESTS {
+   SUBDIRS += tests
+   tests.depends = devlib
+}
@@ -0,0 +1,63 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <QtCore>
+#include <vector>
+
+namespace devlib {
+    struct AffinityPolicy;
+    struct WorkerPlacement;
+}
+
+
+// Where the library's worker threads for a device or a job run, and
+// where their buffers live. DeviceLocal follows the NUMA node of the
+// device's host controller. Pinning is Linux only; elsewhere, or when
+// the node can not be found, threads are left where they are.
+struct devlib::AffinityPolicy
+{
+    enum class Mode {
+        Inherit,        // whatever the creating thread has
+        DeviceLocal,
+        NumaNode,
+        Cpus
+    };
+
+    Mode mode = Mode::Inherit;
+    int numaNode = -1;          // for NumaNode
+    std::vector<int> cpus;      // for Cpus
+
+    static auto deviceLocal(void) {
+        auto policy = AffinityPolicy();
+        policy.mode = Mode::DeviceLocal;
+        return policy;
+    }
+
+    static auto node(int numaNode) {
+        auto policy = AffinityPolicy();
+        policy.mode = Mode::NumaNode;
+        policy.numaNode = numaNode;
+        return policy;
+    }
+
+    static auto cpuSet(std::vector<int> cpus) {
+        auto policy = AffinityPolicy();
+        policy.mode = Mode::Cpus;
+        policy.cpus = std::move(cpus);
+        return policy;
+    }
+};
+
+
+// A live worker thread as it was placed
+struct devlib::WorkerPlacement
+{
+    QString role;               // "verify", "backup-read", "clone-write", "flash"
+    QString devicePath;
+    std::vector<int> cpus;      // effective affinity mask, empty if unknown
+    int cpu;                    // where it ran right after placement, -1 if unknown
+    int numaNode;               // node of that CPU, -1 if unknown
+    int bufferNode;             // node its buffers were bound to, -1 if none
+};
+
+#endif // AFFINITY_H
@@ -0,0 +1,31 @@
+#ifndef BUFFERPOLICY_H
+#define BUFFERPOLICY_H
+
+#include <QtCore>
+
+namespace devlib {
+    struct BufferPolicy;
+}
+
+
+// How the library's I/O staging buffers (flash, clone, backup and
+// verify chunks) get their memory. Anything but the defaults maps
+// buffers of `minimalSize` or more straight from the OS. Linux only;
+// whatever the system refuses falls back step by step: explicit huge
+// pages to transparent ones to normal pages, a failed lock leaves the
+// buffer unlocked, and a failed mapping takes the heap.
+struct devlib::BufferPolicy
+{
+    enum class Pages {
+        Normal,
+        Transparent,    // madvise(MADV_HUGEPAGE)
+        Huge            // MAP_HUGETLB from the reserved pool
+    };
+
+    Pages pages = Pages::Normal;
+    bool prefault = false;      // every page touched on allocation (MAP_POPULATE)
+    bool lock = false;          // mlock, RLIMIT_MEMLOCK permitting
+    qint64 minimalSize = qint64(2) * 1024 * 1024;
+};
+
+#endif // BUFFERPOLICY_H
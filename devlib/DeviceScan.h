@@ -0,0 +1,50 @@
+#ifndef DEVICESCAN_H
+#define DEVICESCAN_H
+
+#include <QtCore>
+#include <vector>
+
+namespace devlib {
+    enum class ScanMode;
+    struct ScanOptions;
+    struct RegionStats;
+    struct HeatMap;
+}
+
+
+enum class devlib::ScanMode
+{
+    Read,           // reads only
+    ReadWrite,      // reads every block and writes it back unchanged
+    Destructive     // writes a pattern over the device, then reads it
+};
+
+
+struct devlib::ScanOptions
+{
+    ScanMode mode = ScanMode::Read;
+    qint64 regionSize = qint64(64) * 1024 * 1024;
+    qint64 length = 0;      // bytes from the device start, 0 for all
+};
+
+
+// Throughput in MB/s and the slowest single request in ms; write
+// figures stay zero in the Read mode
+struct devlib::RegionStats
+{
+    float readMBps;
+    float writeMBps;
+    float maxReadMs;
+    float maxWriteMs;
+};
+
+
+// Region i covers [i * regionSize, (i + 1) * regionSize)
+struct devlib::HeatMap
+{
+    qint64 regionSize;
+    std::vector<RegionStats> regions;
+    bool completed;     // false if an I/O error cut the scan short
+};
+
+#endif // DEVICESCAN_H
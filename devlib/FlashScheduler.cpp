@@ -0,0 +1,43 @@
+#include "FlashScheduler.h"
+
+#include "impl/FlashDispatcher.h"
+
+
+devlib::FlashScheduler::FlashScheduler(FlashLimits const& limits)
+    : _dispatcher(std::make_shared<impl::FlashDispatcher>(limits))
+{ }
+
+
+devlib::FlashScheduler::~FlashScheduler(void)
+{
+    _dispatcher->cancelPending();
+    _dispatcher->wait();
+}
+
+
+auto devlib::FlashScheduler::submit(FlashJob job)
+    -> int
+{
+    Q_ASSERT(job.target);
+    return _dispatcher->submit(std::move(job));
+}
+
+
+void devlib::FlashScheduler::cancelPending(void)
+{
+    _dispatcher->cancelPending();
+}
+
+
+auto devlib::FlashScheduler::wait(void)
+    -> std::vector<FlashJobResult>
+{
+    return _dispatcher->wait();
+}
+
+
+auto devlib::FlashScheduler::groups(void) const
+    -> std::vector<FlashGroupStats>
+{
+    return _dispatcher->groups();
+}
@@ -0,0 +1,99 @@
+#ifndef FLASHSCHEDULER_H
+#define FLASHSCHEDULER_H
+
+#include "Affinity.h"
+#include "StorageDeviceInfo.h"
+
+#include <QtCore>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace devlib {
+    class FlashScheduler;
+    struct FlashJob;
+    struct FlashJobResult;
+    struct FlashLimits;
+    struct FlashGroupStats;
+
+    namespace impl {
+        class FlashDispatcher;
+    }
+}
+
+
+struct devlib::FlashJob
+{
+    QString imagePath;          // raw or Android sparse image
+    std::shared_ptr<IStorageDeviceInfo> target;
+    int priority = 0;           // higher is admitted first, ties in submit order
+    AffinityPolicy affinity;    // for the job's thread and its buffer
+};
+
+
+struct devlib::FlashJobResult
+{
+    int id;
+    QString imagePath;
+    QString devicePath;
+    qint64 written;
+    bool ok;
+};
+
+
+// Ceilings for the adaptive per-group limits. A hub or a controller
+// (USB bus) starts at two concurrent jobs and takes one more while its
+// aggregate throughput keeps growing by `minimalGain` or more.
+struct devlib::FlashLimits
+{
+    int maxPerHub = 4;
+    int maxPerController = 8;
+    int maxTotal = 32;
+    double minimalGain = 0.05;
+    std::chrono::milliseconds sampleWindow = std::chrono::milliseconds(3000);
+};
+
+
+struct devlib::FlashGroupStats
+{
+    QString portPath;       // hub ("1-1.2") or controller bus ("1")
+    bool controller;
+    int running;
+    int limit;
+    float throughputMBps;   // last full sample window
+};
+
+
+// Flashes images onto many devices, admitting queued jobs by priority
+// as long as every group the target sits in has room: its hub (parent
+// of the target's usbPortPath) and its controller (the bus). Devices
+// without a USB port path are limited by maxTotal only. Jobs for a
+// device which is being written wait for it. Thread-safe.
+class devlib::FlashScheduler
+{
+public:
+    explicit FlashScheduler(FlashLimits const& limits = {});
+
+    // Cancels the jobs still queued and waits for the running ones
+    ~FlashScheduler(void);
+
+    FlashScheduler(FlashScheduler const&) = delete;
+    FlashScheduler& operator=(FlashScheduler const&) = delete;
+
+    // id of the job, results refer to it
+    auto submit(FlashJob job) -> int;
+
+    // queued jobs are dropped and reported failed, running ones finish
+    void cancelPending(void);
+
+    // blocks until nothing is queued or running; results of the jobs
+    // finished since the previous call, in completion order
+    auto wait(void) -> std::vector<FlashJobResult>;
+
+    auto groups(void) const -> std::vector<FlashGroupStats>;
+
+private:
+    std::shared_ptr<impl::FlashDispatcher> _dispatcher;
+};
+
+#endif // FLASHSCHEDULER_H
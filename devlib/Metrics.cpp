@@ -0,0 +1,29 @@
+#include "Metrics.h"
+
+#include "impl/MetricsRegistry.h"
+
+
+auto devlib::Metrics::snapshot(void)
+    -> MetricsSnapshot
+{
+    return impl::MetricsRegistry::instance().snapshot();
+}
+
+
+auto devlib::Metrics::prometheusText(void)
+    -> QByteArray
+{
+    return impl::MetricsRegistry::instance().prometheusText();
+}
+
+
+bool devlib::Metrics::startExporter(QString const& socketPath)
+{
+    return impl::MetricsRegistry::instance().startExporter(socketPath);
+}
+
+
+void devlib::Metrics::stopExporter(void)
+{
+    impl::MetricsRegistry::instance().stopExporter();
+}
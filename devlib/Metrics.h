@@ -0,0 +1,57 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "SpeedClass.h"
+
+#include <QtCore>
+#include <vector>
+
+namespace devlib {
+    struct DeviceMetrics;
+    struct MetricsSnapshot;
+    class Metrics;
+}
+
+
+struct devlib::DeviceMetrics
+{
+    QString devicePath;
+    qint64 bytesWritten;
+    qint64 writes;
+    double writeSeconds;                // spent inside write calls
+    float writeMBps;                    // bytesWritten / writeSeconds
+    LatencyPercentiles writeLatency;    // per write call
+};
+
+
+struct devlib::MetricsSnapshot
+{
+    qint64 devicesSeen;         // arrivals, by device list or hotplug, each once
+    qint64 flashesStarted;      // FlashScheduler jobs and clone targets
+    qint64 flashesCompleted;
+    qint64 flashesFailed;
+    qint64 bytesWritten;        // to devices, by every StorageDeviceFile
+    std::vector<DeviceMetrics> devices;
+};
+
+
+// Process wide counters since start-up. Updating them is a relaxed
+// atomic increment on the I/O paths, reading takes a consistent enough
+// snapshot: counters are read one by one, not frozen together.
+class devlib::Metrics
+{
+public:
+    static auto snapshot(void) -> MetricsSnapshot;
+
+    // Prometheus text exposition format, version 0.0.4
+    static auto prometheusText(void) -> QByteArray;
+
+    // Serves prometheusText() on a Unix domain socket at `socketPath`,
+    // as an HTTP response to "GET" requests and as is to anything else,
+    // e.g. `curl --unix-socket <path> http://localhost/metrics`.
+    // Replaces a running exporter. Linux only.
+    static bool startExporter(QString const& socketPath);
+    static void stopExporter(void);
+};
+
+#endif // METRICS_H
@@ -3,6 +3,8 @@
 
 #include "Mountpoint.h"
 
+#include <future>
+
 namespace devlib {
     class IPartition;
 }
@@ -14,17 +16,41 @@ public:
 
     auto filePath(void) const noexcept { return filePath_core(); }
     auto label(void) const noexcept { return label_core(); }
+    auto fsType(void) const noexcept { return fsType_core(); }
+
+    // Partition table entry: type (GPT GUID or MBR "0x0c"),
+    // PARTUUID, GPT name and location on the disk in bytes
+    auto typeId(void) const noexcept { return typeId_core(); }
+    auto uuid(void) const noexcept { return uuid_core(); }
+    auto name(void) const noexcept { return name_core(); }
+    auto start(void) const noexcept { return start_core(); }
+    auto size(void) const noexcept { return size_core(); }
+
     auto mount(QString const& path) { return mount_core(path);}
-    auto mountpoints(void) { return mountpoints_core(); }
+
+    // Mounts on a separate thread, so all partitions of a device
+    // can be mounted at once. The partition object may go away before
+    // the result is ready.
+    auto mountAsync(QString const& path) { return mountAsync_core(path); }
+    auto mountpoints(void) const { return mountpoints_core(); }
 
 private:
     virtual auto filePath_core(void) const noexcept -> QString = 0;
     virtual auto label_core(void) const noexcept -> QString = 0;
+    virtual auto fsType_core(void) const noexcept -> QString = 0;
+    virtual auto typeId_core(void) const noexcept -> QString = 0;
+    virtual auto uuid_core(void) const noexcept -> QString = 0;
+    virtual auto name_core(void) const noexcept -> QString = 0;
+    virtual auto start_core(void) const noexcept -> qint64 = 0;
+    virtual auto size_core(void) const noexcept -> qint64 = 0;
 
     virtual auto mount_core(QString const& path)
         -> std::unique_ptr<IMountpoint> = 0;
 
-    virtual auto mountpoints_core(void)
+    virtual auto mountAsync_core(QString const& path)
+        -> std::future<std::unique_ptr<IMountpoint>> = 0;
+
+    virtual auto mountpoints_core(void) const
         -> std::vector<std::unique_ptr<IMountpoint>> = 0;
 };
 
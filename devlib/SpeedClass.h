@@ -0,0 +1,56 @@
+#ifndef SPEEDCLASS_H
+#define SPEEDCLASS_H
+
+#include <QtCore>
+#include <chrono>
+
+namespace devlib {
+    enum class SpeedGrade;
+    struct SpeedTestOptions;
+    struct LatencyPercentiles;
+    struct SpeedClass;
+}
+
+
+// Slow:  below 10 MB/s sequential or 100 IOPS random writes (< Class 10)
+// Fast:  30 MB/s and 500 IOPS or more (U3 / A1 territory)
+enum class devlib::SpeedGrade
+{
+    Unknown,
+    Slow,
+    Medium,
+    Fast
+};
+
+
+struct devlib::SpeedTestOptions
+{
+    qint64 scratchOffset = -1;          // aligned start, middle of the device if negative
+    qint64 scratchSize = qint64(16) * 1024 * 1024;
+    std::chrono::milliseconds phaseDuration = std::chrono::milliseconds(750);
+    bool preserveContents = true;       // put the touched blocks back afterwards
+    bool useCache = true;               // reuse the result for the same serial
+};
+
+
+struct devlib::LatencyPercentiles
+{
+    float p50Ms;
+    float p90Ms;
+    float p99Ms;
+};
+
+
+struct devlib::SpeedClass
+{
+    float sequentialReadMBps;
+    float sequentialWriteMBps;
+    float randomReadIops;       // 4 KiB requests
+    float randomWriteIops;
+    LatencyPercentiles readLatency;
+    LatencyPercentiles writeLatency;
+    SpeedGrade grade;
+    bool cached;                // measured earlier for the same serial
+};
+
+#endif // SPEEDCLASS_H
@@ -1,13 +1,77 @@
 #ifndef STORAGEDEVICEFILE_H
 #define STORAGEDEVICEFILE_H
 
+#include "Affinity.h"
+#include "DeviceScan.h"
+#include "SpeedClass.h"
+
 #include <QtCore>
 #include <cassert>
+#include <chrono>
 
 namespace devlib {
     class IStorageDeviceFile;
+    struct UmountPolicy;
+    struct VerifyResult;
+    struct BackupOptions;
+    struct BackupResult;
+    struct CapacityProbeResult;
 }
 
+
+// How open() gets the device's filesystems out of the way: all of them
+// are unmounted at once and retried while busy until `deadline`, then
+// lazily detached (MNT_DETACH) if `lazyDetach` is set.
+struct devlib::UmountPolicy
+{
+    std::chrono::milliseconds deadline;
+    bool lazyDetach;
+};
+
+
+// Outcome of IStorageDeviceFile::verify()
+struct devlib::VerifyResult
+{
+    qint64 verified;       // bytes from the device start that matched
+    qint64 firstMismatch;  // offset of the first differing byte, -1 if none
+    bool completed;        // false if the device or the source could not be read
+
+    bool matches(void) const { return completed && firstMismatch == -1; }
+};
+
+
+struct devlib::BackupOptions
+{
+    qint64 length = 0;           // bytes from the device start, 0 for all
+    bool compress = false;       // zstd stream instead of a sparse raw image,
+                                 // needs a build with CONFIG+=DEVLIB_WITH_ZSTD
+    int compressionLevel = 3;
+    int compressionThreads = 0;  // zstd workers, 0 for one per core
+    QString bmapPath;            // bmaptool block map of the non-zero blocks
+};
+
+
+// Outcome of IStorageDeviceFile::backup()
+struct devlib::BackupResult
+{
+    qint64 size;        // bytes read from the device
+    qint64 mappedSize;  // of them in non-zero blocks
+    bool ok;
+};
+
+
+// Outcome of IStorageDeviceFile::probeCapacity()
+struct devlib::CapacityProbeResult
+{
+    qint64 reportedCapacity;
+    qint64 verifiedCapacity;  // every sample below it kept its data
+    qint64 firstBadOffset;    // lowest sample that lost or aliased data, -1 if none
+    int samples;              // blocks probed, aliases included
+    bool completed;           // false on I/O errors or unrestored blocks
+
+    bool isCounterfeit(void) const { return completed && firstBadOffset != -1; }
+};
+
 class devlib::IStorageDeviceFile : public QFile
 {
     Q_OBJECT
@@ -28,7 +92,93 @@ public:
     auto fileName() const
         -> QString override final { return fileName_core(); }
 
-    void sync() { return sync_core(); }
+    // written data reached the device, false on a write-back error
+    bool sync() { return sync_core(); }
+
+    void setUmountPolicy(UmountPolicy const& policy) {
+        Q_ASSERT(!isOpen());
+        setUmountPolicy_core(policy);
+    }
+
+    // Placement of the worker threads verify() and backup() start and
+    // of their buffers; the calling thread is never moved
+    void setAffinityPolicy(AffinityPolicy const& policy) {
+        setAffinityPolicy_core(policy);
+    }
+
+    // mountpoints which kept the last open() from succeeding
+    auto busyMountpoints(void) const { return busyMountpoints_core(); }
+
+    // Reads the device back bypassing the page cache and compares it
+    // with `length` bytes of `source` (up to its end if negative),
+    // starting at the first byte of the device. Pending writes of this
+    // file are flushed first.
+    auto verify(QIODevice& source, qint64 length = -1) -> VerifyResult {
+        Q_ASSERT(source.isReadable());
+        return verify_core(source, length);
+    }
+
+    // Writes an Android sparse image from `source`, expanding it on the
+    // fly; nothing but one chunk buffer is held in memory. Returns the
+    // expanded size, -1 on a malformed image or a write error.
+    auto writeSparseImage(QIODevice& source) -> qint64 {
+        Q_ASSERT(source.isReadable());
+        Q_ASSERT(isOpen() && isWritable());
+        return writeSparseImage_core(source);
+    }
+
+    // Streams the device into the image file bypassing the page cache.
+    // All-zero 4 KiB blocks are left as holes in a raw image; memory use
+    // is a few read-ahead buffers whatever the device size. The file
+    // must be open, so the device is unmounted and stays consistent
+    // while it is read. Fails if the length is not given and the
+    // capacity is unknown.
+    auto backup(QString const& imagePath, BackupOptions const& options = {})
+        -> BackupResult
+    {
+        Q_ASSERT(isOpen());
+        return backup_core(imagePath, options);
+    }
+
+    // Times large aligned requests over the whole device and reports
+    // throughput and worst latency per region. The writing modes need
+    // the file opened for writing; ReadWrite keeps the data intact.
+    auto scan(ScanOptions const& options = {}) -> HeatMap {
+        Q_ASSERT(options.regionSize > 0);
+        Q_ASSERT(options.mode == ScanMode::Read || (isOpen() && isWritable()));
+        return scan_core(options);
+    }
+
+    // Writes unique sentinel blocks at `samples` offsets across the
+    // reported capacity, and at the low addresses each of them would
+    // wrap onto, and reads them back bypassing the page cache to find
+    // addresses that wrap or drop writes. Takes a few thousand small
+    // writes, not a full pass. With `preserveContents` the original
+    // blocks are put back afterwards.
+    auto probeCapacity(int samples = 256, bool preserveContents = true)
+        -> CapacityProbeResult
+    {
+        Q_ASSERT(samples >= 2);
+        Q_ASSERT(isOpen() && isWritable());
+        return probeCapacity_core(samples, preserveContents);
+    }
+
+    // A second or two of sequential and random 4 KiB I/O inside a
+    // scratch region, graded against SD speed class thresholds. Devices
+    // with a serial are measured once per process unless `useCache` is
+    // off; the region is put back unless `preserveContents` is off.
+    auto classifySpeed(SpeedTestOptions const& options = {}) -> SpeedClass {
+        Q_ASSERT(options.scratchSize > 0);
+        Q_ASSERT(isOpen() && isWritable());
+        return classifySpeed_core(options);
+    }
+
+    // Android sparse images start with 0xED26FF3A (little endian)
+    static bool isSparseImage(QIODevice& source) {
+        auto magic = source.peek(4);
+        return magic.size() == 4
+            && qFromLittleEndian<quint32>(magic.constData()) == 0xED26FF3Au;
+    }
 
     auto seek(qint64 pos) -> bool override final {
         Q_ASSERT(pos >= 0);
@@ -61,7 +211,20 @@ protected:
 private:
     virtual bool open_core(OpenMode mode, bool withAuthorization = false) = 0;
     virtual void close_core(void) = 0;
-    virtual void sync_core() = 0;
+    virtual bool sync_core() = 0;
+
+    virtual void setUmountPolicy_core(UmountPolicy const& policy) = 0;
+    virtual void setAffinityPolicy_core(AffinityPolicy const& policy) = 0;
+    virtual auto busyMountpoints_core(void) const -> QStringList = 0;
+
+    virtual auto verify_core(QIODevice& source, qint64 length) -> VerifyResult = 0;
+    virtual auto writeSparseImage_core(QIODevice& source) -> qint64 = 0;
+    virtual auto backup_core(QString const& imagePath, BackupOptions const& options)
+        -> BackupResult = 0;
+    virtual auto scan_core(ScanOptions const& options) -> HeatMap = 0;
+    virtual auto probeCapacity_core(int samples, bool preserveContents)
+        -> CapacityProbeResult = 0;
+    virtual auto classifySpeed_core(SpeedTestOptions const& options) -> SpeedClass = 0;
 
     virtual auto readData_core(char* data, qint64 len) -> qint64 = 0;
     virtual auto writeData_core(char const* data, qint64 len) -> qint64 = 0;
@@ -18,6 +18,14 @@ public:
 
     auto filePath(void) const noexcept { return filePath_core(); }
     auto usbPortPath(void) const noexcept { return usbPortPath_core(); }
+    // Read on first use and remembered by this object
+    auto capacity(void) const { return capacity_core(); }
+    auto serial(void) const { return serial_core(); }
+    auto vendorName(void) const { return vendorName_core(); }
+    auto model(void) const { return model_core(); }
+    auto isRemovable(void) const { return isRemovable_core(); }
+    auto isReadOnly(void) const { return isReadOnly_core(); }
+
     auto mountpoints(void) const { return mountpoints_core(); }
     auto partitions(void) const { return partitions_core(); }
 
@@ -31,6 +39,13 @@ private:
     virtual auto usbPortPath_core(void) const noexcept
         -> QString = 0;
 
+    virtual auto capacity_core(void) const -> qint64 = 0;
+    virtual auto serial_core(void) const -> QString = 0;
+    virtual auto vendorName_core(void) const -> QString = 0;
+    virtual auto model_core(void) const -> QString = 0;
+    virtual bool isRemovable_core(void) const = 0;
+    virtual bool isReadOnly_core(void) const = 0;
+
     virtual auto mountpoints_core(void) const
         -> std::vector<std::unique_ptr<IMountpoint>> = 0;
 
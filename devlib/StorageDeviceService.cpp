@@ -1,56 +1,82 @@
 #include "StorageDeviceService.h"
 
-#include "impl/MountpointImpl.h"
-#include "impl/PartitionImpl.h"
 #include "impl/StorageDeviceInfoImpl.h"
 #include "impl/StorageDeviceFileImpl.h"
+#include "impl/DeviceCloner.h"
+#include "impl/DeviceRegistry.h"
+#include "impl/IoBuffer.h"
+#include "impl/MetricsRegistry.h"
+#include "impl/Placement.h"
 #include "native/native.h"
+#include "native/trace.h"
+
+
+namespace {
+    constexpr auto Clone_umountDeadline = std::chrono::milliseconds(3000);
+
+
+    // A mounted source may change while it is read. Unmounted as a flash
+    // target would be, and then opened exclusively, it stays as it is.
+    // Platforms without umountDisk() keep per-mountpoint `locks`.
+    bool umountCloneSource(devlib::IStorageDeviceInfo const& source,
+                           std::vector<std::unique_ptr<devlib::IMountpointLock>>& locks)
+    {
+        using devlib::native::UmountStatus;
+
+        auto report = devlib::native::umountDisk(source.filePath(), Clone_umountDeadline, false);
+
+        if (report.status == UmountStatus::Busy) {
+            auto busy = QStringList();
+            for (auto const& mntpt : report.busyMountpoints) {
+                busy << mntpt;
+            }
+
+            qWarning() << "Can not clone" << source.filePath()
+                       << ", mountpoints are busy:" << busy.join(", ");
+            return false;
+        }
+
+        if (report.status == UmountStatus::NotHandled) {
+            for (auto const& mntpt : source.mountpoints()) {
+                auto lock = mntpt->umount();
+                if (!lock->locked()) {
+                    qWarning() << "Can not clone" << source.filePath()
+                               << ", mountpoint is busy:" << mntpt->fsPath();
+                    return false;
+                }
+                locks.push_back(std::move(lock));
+            }
+        }
+
+        return true;
+    }
+}
 
 
 devlib::StorageDeviceService::StorageDeviceService()
+    : _registry(std::make_shared<impl::DeviceRegistry>())
 { }
 
 
 auto devlib::StorageDeviceService::getAvailableStorageDevices(void)
     -> std::vector<std::unique_ptr<IStorageDeviceInfo>>
 {
-    auto mntptFactory = [] (auto const& mntptName) {
-        auto mntptLockFactory = [] (auto handle) {
-            return std::make_unique<
-                impl::MountpointLockImpl
-            >(std::move(handle));
-        };
-
-        return std::make_unique<impl::MountpointImpl>(
-            mntptName, mntptLockFactory
-        );
-    };
-
-    auto partitionFactory =
-        [mntptFactory] (auto const& partName, auto const& partLabel) {
-            return std::make_unique<impl::PartitionImpl>(
-                partName, partLabel, mntptFactory
-            );
-        };
+    native::trace::Span span("service", "enumerate");
 
-    auto storageDeviceInfoFactory =
-        [partitionFactory, mntptFactory] (int vid, int pid, auto const& filePath, auto const& usbPortPath) {
-            return std::make_unique<impl::StorageDeviceInfoImpl>(
-                vid, pid, filePath, usbPortPath, partitionFactory, mntptFactory
-            );
-        };
+    auto devsList = _registry->devices();
+    native::trace::counter("service", "devices", qint64(devsList->size()));
 
-    auto devsList = native::requestUsbDeviceList();
     auto storageDevicesList = std::vector<
             std::unique_ptr<IStorageDeviceInfo>
-    >(devsList.size());
-
-    std::transform(devsList.cbegin(), devsList.cend(), storageDevicesList.begin(),
-        [&storageDeviceInfoFactory] (auto const& deviceInfo) {
-            return storageDeviceInfoFactory(std::get<0>(deviceInfo),
-                                            std::get<1>(deviceInfo),
-                                            std::get<2>(deviceInfo),
-                                            std::get<3>(deviceInfo));
+    >(devsList->size());
+
+    // aliasing pointers: every device shares the list's control block
+    std::transform(devsList->cbegin(), devsList->cend(), storageDevicesList.begin(),
+        [this, &devsList] (auto const& deviceEntry) {
+            return std::make_unique<impl::StorageDeviceInfoImpl>(
+                std::shared_ptr<impl::DeviceRegistry::DeviceEntry const>(devsList, &deviceEntry),
+                _registry
+            );
         }
     );
 
@@ -58,6 +84,49 @@ auto devlib::StorageDeviceService::getAvailableStorageDevices(void)
 }
 
 
+auto devlib::StorageDeviceService::snapshot(void)
+    -> StorageSnapshot
+{
+    native::trace::Span span("service", "snapshot");
+    return _registry->snapshot();
+}
+
+
+auto devlib::StorageDeviceService::usbTopology(void)
+    -> UsbTopology
+{
+    native::trace::Span span("service", "usbTopology");
+    return _registry->usbTopology();
+}
+
+
+void devlib::StorageDeviceService::rescan(void)
+{
+    native::trace::Span span("service", "rescan");
+    _registry->rescan();
+}
+
+
+void devlib::StorageDeviceService::setProbeLimits(int threadsCount,
+                                                  std::chrono::milliseconds deviceTimeout)
+{
+    _registry->setProbeLimits(threadsCount, deviceTimeout);
+}
+
+
+void devlib::StorageDeviceService::setDiscoveryBackend(DiscoveryBackend backend)
+{
+    switch (backend) {
+    case DiscoveryBackend::Sysfs:
+        _registry->setDiscoveryBackend(native::DiscoveryBackend::Sysfs);
+        break;
+    case DiscoveryBackend::Platform:
+        _registry->setDiscoveryBackend(native::DiscoveryBackend::Platform);
+        break;
+    }
+}
+
+
 auto devlib::StorageDeviceService::makeStorageDeviceFile(
     const QString &deviceFileName,
     std::shared_ptr<IStorageDeviceInfo> deviceInfo
@@ -67,3 +136,103 @@ auto devlib::StorageDeviceService::makeStorageDeviceFile(
         deviceFileName, std::move(deviceInfo)
     );
 }
+
+
+auto devlib::StorageDeviceService::clone(
+    std::shared_ptr<IStorageDeviceInfo> const& source,
+    std::vector<std::shared_ptr<IStorageDeviceInfo>> const& targets,
+    CloneOptions const& options
+) -> std::vector<CloneResult>
+{
+    native::trace::Span span("service", "clone", source->filePath());
+    auto length = options.length > 0 ? options.length : source->capacity();
+
+    auto ranges = std::vector<impl::DeviceCloner::Range>();
+    if (options.skipUnallocated && length > 0) {
+        for (auto const& partition : source->partitions()) {
+            ranges.emplace_back(partition->start(), partition->size());
+        }
+        ranges = impl::DeviceCloner::allocatedRanges(length, std::move(ranges));
+    } else {
+        ranges.emplace_back(0, length > 0 ? length : -1);
+    }
+
+    auto results = std::vector<CloneResult>();
+    auto files = std::vector<std::unique_ptr<IStorageDeviceFile>>();
+    auto opened = std::vector<IStorageDeviceFile*>();
+
+    auto& metrics = impl::MetricsRegistry::instance();
+    auto sourceLocks = std::vector<std::unique_ptr<IMountpointLock>>();
+
+    if (!umountCloneSource(*source, sourceLocks)) {
+        for (auto const& target : targets) {
+            metrics.flashStarted();
+            metrics.flashFinished(false);
+            results.push_back({ target->filePath(), 0, false });
+        }
+        return results;
+    }
+
+    for (auto const& target : targets) {
+        metrics.flashStarted();
+        results.push_back({ target->filePath(), 0, false });
+        files.push_back(makeStorageDeviceFile(target->filePath(), target));
+
+        auto fits = target->capacity() == 0 || target->capacity() >= length;
+        if (target->filePath() == source->filePath() || !fits) {
+            qWarning() << "Can not clone" << source->filePath() << "to" << target->filePath();
+            continue;
+        }
+
+        if (files.back()->open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+            opened.push_back(files.back().get());
+        }
+    }
+
+    auto written = impl::DeviceCloner(source->filePath(), ranges, options.affinity)
+        .run(opened);
+
+    for (auto i = std::size_t(0), next = std::size_t(0); i < files.size(); i++) {
+        if (!files[i]->isOpen()) {
+            continue;
+        }
+
+        native::trace::Span finishing("service", "syncTarget", files[i]->fileName());
+        auto synced = files[i]->sync();
+        files[i]->close();
+
+        if (!synced) {
+            qWarning() << "Can not flush clone target" << files[i]->fileName();
+        }
+
+        results[i].written = qMax(written[next], qint64(0));
+        results[i].ok = written[next] >= 0 && synced;
+        next++;
+    }
+
+    for (auto const& result : results) {
+        metrics.flashFinished(result.ok);
+    }
+
+    return results;
+}
+
+
+auto devlib::StorageDeviceService::workerPlacements(void)
+    -> std::vector<WorkerPlacement>
+{
+    return impl::workerPlacements();
+}
+
+
+void devlib::StorageDeviceService::setBufferPolicy(BufferPolicy const& policy)
+{
+    impl::IoBuffer::setPolicy(policy);
+}
+
+
+auto devlib::StorageDeviceService::bufferPolicy(void)
+    -> BufferPolicy
+{
+    return impl::IoBuffer::policy();
+}
@@ -1,17 +1,55 @@
 #ifndef STORAGEDEVICESERVICE_H
 #define STORAGEDEVICESERVICE_H
 
+#include "BufferPolicy.h"
 #include "StorageDeviceInfo.h"
 #include "StorageDeviceFile.h"
+#include "StorageSnapshot.h"
+#include "UsbTopology.h"
 #include <memory>
+#include <chrono>
 
 namespace devlib {
     class StorageDeviceService;
+    struct CloneOptions;
+    struct CloneResult;
+
+    namespace impl {
+        class DeviceRegistry;
+    }
 }
 
+struct devlib::CloneOptions
+{
+    qint64 length = 0;            // bytes from the source start, 0 for all
+    bool skipUnallocated = false; // copy only partition tables and partitions
+    AffinityPolicy affinity;      // for the writer threads, resolved per target
+};
+
+
+struct devlib::CloneResult
+{
+    QString filePath;   // target device
+    qint64 written;
+    bool ok;
+};
+
+
+// Thread safety: every method may be called from any thread at once.
+// Services made by instance() are independent; objects returned by one
+// (device infos, partitions, mountpoints) share its cache and stay
+// usable from other threads as long as each object is used by one
+// thread at a time. Enumeration never waits for another thread's OS
+// query, and a StorageDeviceFile is private to its caller, so flashing
+// one device goes on while others are listed or opened.
 class devlib::StorageDeviceService
 {
 public:
+    // Where the device list comes from. Sysfs reads /sys/class/block
+    // directly instead of going through libudev; it reports the same
+    // devices and is Linux only, other systems ignore the choice.
+    enum class DiscoveryBackend { Platform, Sysfs };
+
     virtual ~StorageDeviceService(void) = default;
 
     static auto instance(void) {
@@ -21,12 +59,50 @@ public:
     virtual auto getAvailableStorageDevices(void)
         -> std::vector<std::unique_ptr<IStorageDeviceInfo>>;
 
+    // Whole device/partition/mountpoint tree at once
+    virtual auto snapshot(void) -> StorageSnapshot;
+
+    // Port path -> device lookups for slot based setups
+    virtual auto usbTopology(void) -> UsbTopology;
+
+    // Results are cached and kept up to date by hotplug and
+    // mount notifications. Drops the cache, so the next query
+    // probes devices again.
+    virtual void rescan(void);
+
+    // snapshot() probes up to `threadsCount` devices in parallel and
+    // returns within `deviceTimeout`, devices that did not answer by
+    // then are marked as timed out. Probes stuck on hung devices are
+    // left behind and do not count toward `threadsCount`; later calls
+    // do not wait for them again.
+    void setProbeLimits(int threadsCount, std::chrono::milliseconds deviceTimeout);
+
+    void setDiscoveryBackend(DiscoveryBackend backend);
+
+    // Copies `source` onto every target at once, reading it only once.
+    // Targets are unmounted and opened like makeStorageDeviceFile() does;
+    // one failing target does not stop the others.
+    static auto clone(std::shared_ptr<IStorageDeviceInfo> const& source,
+                      std::vector<std::shared_ptr<IStorageDeviceInfo>> const& targets,
+                      CloneOptions const& options = {})
+        -> std::vector<CloneResult>;
+
+    // Library worker threads alive right now and where they run
+    static auto workerPlacements(void) -> std::vector<WorkerPlacement>;
+
+    // Process wide, applies to buffers allocated afterwards
+    static void setBufferPolicy(BufferPolicy const& policy);
+    static auto bufferPolicy(void) -> BufferPolicy;
+
     static auto makeStorageDeviceFile(
             QString const& deviceFileName,
             std::shared_ptr<devlib::IStorageDeviceInfo> deviceInfo
     ) -> std::unique_ptr<IStorageDeviceFile>;
 
     StorageDeviceService(void);
+
+private:
+    std::shared_ptr<impl::DeviceRegistry> _registry;
 };
 
 
@@ -0,0 +1,15 @@
+#include "StorageSnapshot.h"
+
+
+devlib::StorageSnapshot::StorageSnapshot(void)
+    : _data(std::make_shared<Data>())
+{ }
+
+
+devlib::StorageSnapshot::StorageSnapshot(std::vector<DeviceRecord> devices,
+                                         std::vector<PartitionRecord> partitions,
+                                         std::vector<MountpointRecord> mountpoints)
+    : _data(std::make_shared<Data>(
+          Data{ std::move(devices), std::move(partitions), std::move(mountpoints) }
+      ))
+{ }
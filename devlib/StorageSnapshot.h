@@ -0,0 +1,136 @@
+#ifndef STORAGESNAPSHOT_H
+#define STORAGESNAPSHOT_H
+
+#include <QtCore>
+#include <memory>
+#include <vector>
+
+namespace devlib {
+    struct MountpointRecord;
+    struct PartitionRecord;
+    struct DeviceRecord;
+
+    template<typename T>
+    class SnapshotRange;
+
+    class StorageSnapshot;
+}
+
+
+struct devlib::MountpointRecord
+{
+    QString fsPath;
+    QString device;
+};
+
+
+struct devlib::PartitionRecord
+{
+    QString filePath;
+    QString label;
+    QString fsType;
+    QString typeId;
+    QString uuid;
+    QString name;
+    qint64 start;
+    qint64 size;
+
+    // position inside StorageSnapshot mountpoints storage
+    std::size_t firstMountpoint;
+    std::size_t mountpointsCount;
+};
+
+
+struct devlib::DeviceRecord
+{
+    int vid;
+    int pid;
+    QString filePath;
+    QString usbPortPath;
+
+    // partition table did not answer in time, partitions are unknown
+    bool probeTimedOut;
+
+    // position inside StorageSnapshot partitions storage
+    std::size_t firstPartition;
+    std::size_t partitionsCount;
+
+    // all mountpoints of the disk: whole-disk ones first,
+    // then the ones of each partition in partitions order
+    std::size_t firstMountpoint;
+    std::size_t mountpointsCount;
+};
+
+
+template<typename T>
+class devlib::SnapshotRange
+{
+public:
+    SnapshotRange(T const* first, std::size_t count)
+        : _first(first), _count(count)
+    { }
+
+    auto begin(void) const { return _first; }
+    auto end(void) const { return _first + _count; }
+    auto size(void) const { return _count; }
+    auto empty(void) const { return _count == 0; }
+
+    auto operator[](std::size_t index) const -> T const& {
+        Q_ASSERT(index < _count);
+        return _first[index];
+    }
+
+private:
+    T const* _first;
+    std::size_t _count;
+};
+
+
+// Immutable device/partition/mountpoint tree. Records are kept in
+// three flat arrays shared between copies, so a snapshot is cheap
+// to copy and safe to read from any number of threads.
+class devlib::StorageSnapshot
+{
+public:
+    StorageSnapshot(void);
+
+    StorageSnapshot(std::vector<DeviceRecord> devices,
+                    std::vector<PartitionRecord> partitions,
+                    std::vector<MountpointRecord> mountpoints);
+
+    auto devices(void) const -> SnapshotRange<DeviceRecord> {
+        return { _data->devices.data(), _data->devices.size() };
+    }
+
+    auto partitions(DeviceRecord const& device) const
+        -> SnapshotRange<PartitionRecord>
+    {
+        return { _data->partitions.data() + device.firstPartition,
+                 device.partitionsCount };
+    }
+
+    auto mountpoints(DeviceRecord const& device) const
+        -> SnapshotRange<MountpointRecord>
+    {
+        return { _data->mountpoints.data() + device.firstMountpoint,
+                 device.mountpointsCount };
+    }
+
+    auto mountpoints(PartitionRecord const& partition) const
+        -> SnapshotRange<MountpointRecord>
+    {
+        return { _data->mountpoints.data() + partition.firstMountpoint,
+                 partition.mountpointsCount };
+    }
+
+private:
+    struct Data {
+        std::vector<DeviceRecord> devices;
+        std::vector<PartitionRecord> partitions;
+        std::vector<MountpointRecord> mountpoints;
+    };
+
+    std::shared_ptr<Data const> _data;
+};
+
+#endif // STORAGESNAPSHOT_H
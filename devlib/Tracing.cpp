@@ -0,0 +1,41 @@
+#include "Tracing.h"
+
+#include "native/trace.h"
+
+
+void devlib::Tracing::start(void)
+{
+    native::trace::setEnabled(true);
+}
+
+
+void devlib::Tracing::stop(void)
+{
+    native::trace::setEnabled(false);
+}
+
+
+bool devlib::Tracing::isRunning(void)
+{
+    return native::trace::isEnabled();
+}
+
+
+auto devlib::Tracing::chromeTrace(void)
+    -> QByteArray
+{
+    return native::trace::chromeTrace();
+}
+
+
+bool devlib::Tracing::writeChromeTrace(QString const& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Can not write trace to" << filePath;
+        return false;
+    }
+
+    auto trace = chromeTrace();
+    return file.write(trace) == trace.size();
+}
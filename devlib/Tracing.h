@@ -0,0 +1,29 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QtCore>
+
+namespace devlib {
+    class Tracing;
+}
+
+
+// Opt-in timeline of where the library's time goes: enumeration,
+// unmounting, opening, writing, syncing and verifying, per thread and
+// per device. The output is Chrome trace-event JSON, which Perfetto
+// (ui.perfetto.dev) and chrome://tracing open. Off by default, and
+// close to free while off.
+class devlib::Tracing
+{
+public:
+    // Drops whatever an earlier run recorded
+    static void start(void);
+    static void stop(void);
+    static bool isRunning(void);
+
+    // Complete once stop() returned and the traced calls did too
+    static auto chromeTrace(void) -> QByteArray;
+    static bool writeChromeTrace(QString const& filePath);
+};
+
+#endif // TRACING_H
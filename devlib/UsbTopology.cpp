@@ -0,0 +1,156 @@
+#include "UsbTopology.h"
+
+
+auto devlib::UsbTopology::parentOf(QString const& portPath)
+    -> QString
+{
+    auto dot = portPath.lastIndexOf('.');
+    if (dot != -1) {
+        return portPath.left(dot);
+    }
+
+    auto dash = portPath.indexOf('-');
+    return dash != -1 ? portPath.left(dash) : QString();
+}
+
+
+bool devlib::UsbTopology::isPortPath(QString const& portPath)
+{
+    auto dash = portPath.indexOf('-');
+    if (dash <= 0 || dash == portPath.size() - 1) {
+        return false;
+    }
+
+    for (auto i = 0; i < portPath.size(); i++) {
+        auto ch = portPath.at(i);
+        auto allowed = ch.isDigit() || (i == dash) || (i > dash && ch == '.');
+        if (!allowed) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+auto devlib::UsbTopology::node(QString const& portPath) const
+    -> Node const*
+{
+    auto found = _nodes.constFind(portPath);
+    return found != _nodes.cend() ? &found.value() : nullptr;
+}
+
+
+auto devlib::UsbTopology::deviceAt(QString const& portPath) const
+    -> QString
+{
+    auto found = node(portPath);
+    return found && !found->devicePaths.isEmpty() ? found->devicePaths.first() : QString();
+}
+
+
+auto devlib::UsbTopology::devicesAt(QString const& portPath) const
+    -> QStringList
+{
+    auto found = node(portPath);
+    return found ? found->devicePaths : QStringList();
+}
+
+
+auto devlib::UsbTopology::devicesBelow(QString const& portPath) const
+    -> std::vector<QString>
+{
+    auto devices = std::vector<QString>();
+    auto pending = QStringList{ portPath };
+
+    while (!pending.isEmpty()) {
+        auto current = node(pending.takeLast());
+        if (!current) {
+            continue;
+        }
+
+        for (auto const& devicePath : current->devicePaths) {
+            devices.push_back(devicePath);
+        }
+
+        // reversed, so the subtree is walked in insertion order
+        for (auto it = current->children.crbegin(); it != current->children.crend(); ++it) {
+            pending.append(*it);
+        }
+    }
+
+    return devices;
+}
+
+
+void devlib::UsbTopology::insert(QString const& portPath, QString const& devicePath)
+{
+    if (!isPortPath(portPath) || devicePath.isEmpty()) {
+        return;
+    }
+
+    remove(devicePath);
+
+    auto child = portPath;
+    auto& leaf = _nodes[portPath];
+    leaf.portPath = portPath;
+    leaf.devicePaths.append(devicePath);
+    _portByDevice.insert(devicePath, portPath);
+
+    // link up to the bus root, stop at the first already linked hub
+    for (auto parent = parentOf(child); !parent.isEmpty(); parent = parentOf(child)) {
+        auto& childNode = _nodes[child];
+        if (!childNode.parent.isEmpty()) {
+            break;
+        }
+        childNode.parent = parent;
+
+        auto& parentNode = _nodes[parent];
+        parentNode.portPath = parent;
+        parentNode.children.append(child);
+
+        child = parent;
+    }
+}
+
+
+void devlib::UsbTopology::remove(QString const& devicePath)
+{
+    auto portPath = _portByDevice.take(devicePath);
+    if (portPath.isEmpty()) {
+        return;
+    }
+
+    auto found = _nodes.find(portPath);
+    if (found == _nodes.end()) {
+        return;
+    }
+
+    // other LUNs of the same reader stay
+    found->devicePaths.removeOne(devicePath);
+    detach(portPath);
+}
+
+
+// drops the node and hubs above it that have nothing plugged in anymore
+void devlib::UsbTopology::detach(QString const& portPath)
+{
+    auto current = portPath;
+
+    while (!current.isEmpty()) {
+        auto found = _nodes.constFind(current);
+        if (found == _nodes.cend()
+                || !found->children.isEmpty()
+                || !found->devicePaths.isEmpty()) {
+            return;
+        }
+
+        auto parent = found->parent;
+        _nodes.remove(current);
+
+        if (!parent.isEmpty()) {
+            _nodes[parent].children.removeOne(current);
+        }
+        current = parent;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef USBTOPOLOGY_H
+#define USBTOPOLOGY_H
+
+#include <QtCore>
+#include <vector>
+
+namespace devlib {
+    class UsbTopology;
+}
+
+
+// Hub tree keyed by USB port path ("1-1.2.3"). Bus roots are keyed
+// by bus number ("1"), intermediate hubs are created on demand.
+// Lookups by port path are O(1); a copy shares data with the original.
+class devlib::UsbTopology
+{
+public:
+    struct Node {
+        QString portPath;
+        QString parent;         // empty for a bus root
+        QStringList children;   // port paths, in insertion order
+        // storage devices plugged here in insertion order, several for
+        // the LUNs of a multi-slot card reader
+        QStringList devicePaths;
+    };
+
+    // parent port path: "1-1.2.3" -> "1-1.2" -> "1-1" -> "1"
+    static auto parentOf(QString const& portPath) -> QString;
+
+    // "<bus>-<port>[.<port>...]", non-USB disks report something else
+    static bool isPortPath(QString const& portPath);
+
+    auto node(QString const& portPath) const -> Node const*;
+
+    // first storage device in the slot, empty if the slot is free or unknown
+    auto deviceAt(QString const& portPath) const -> QString;
+
+    // all of them, one per LUN
+    auto devicesAt(QString const& portPath) const -> QStringList;
+
+    // storage devices in the subtree of `portPath`, including itself
+    auto devicesBelow(QString const& portPath) const -> std::vector<QString>;
+
+    auto portPathOf(QString const& devicePath) const -> QString {
+        return _portByDevice.value(devicePath);
+    }
+
+    void insert(QString const& portPath, QString const& devicePath);
+    void remove(QString const& devicePath);
+
+private:
+    void detach(QString const& portPath);
+
+    QHash<QString, Node> _nodes;
+    QHash<QString, QString> _portByDevice;
+};
+
+#endif // USBTOPOLOGY_H
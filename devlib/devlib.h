@@ -1,10 +1,19 @@
 #ifndef DEVLIB_H
 #define DEVLIB_H
 
+#include "Affinity.h"
+#include "BufferPolicy.h"
+#include "DeviceScan.h"
+#include "FlashScheduler.h"
+#include "Metrics.h"
 #include "Partition.h"
 #include "Mountpoint.h"
+#include "SpeedClass.h"
 #include "StorageDeviceInfo.h"
 #include "StorageDeviceFile.h"
 #include "StorageDeviceService.h"
+#include "StorageSnapshot.h"
+#include "Tracing.h"
+#include "UsbTopology.h"
 
 #endif // DEVLIB_H
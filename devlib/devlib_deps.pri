@@ -7,6 +7,16 @@ linux:LIBS += \
         -ludev \
         -lblkid \
 
+DEVLIB_WITH_TSAN {
+    QMAKE_CXXFLAGS += -fsanitize=thread -fno-omit-frame-pointer
+    QMAKE_LFLAGS += -fsanitize=thread
+}
+
+DEVLIB_WITH_ZSTD {
+    DEFINES += DEVLIB_WITH_ZSTD
+    LIBS += -lzstd
+}
+
 macx {
     QT += xml
     LIBS += \
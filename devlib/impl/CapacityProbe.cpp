@@ -0,0 +1,213 @@
+#include "CapacityProbe.h"
+#include "IoBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace {
+    // the partition table area is left alone, a crash mid-probe
+    // must not leave the card unreadable
+    constexpr auto Probe_firstOffset = qint64(1024) * 1024;
+
+    // smallest real size of a fake card whose aliases are probed
+    constexpr auto Probe_minAliasedSize = qint64(16) * 1024 * 1024;
+
+    constexpr char Probe_magic[8] = { 'd', 'e', 'v', 'l', 'i', 'b', 'C', 'P' };
+    constexpr auto Probe_headerSize = 24; // magic, nonce, sample index
+
+
+    class HandleDevice : public devlib::impl::ProbeDevice
+    {
+    public:
+        HandleDevice(devlib::native::io::FileHandle* reader,
+                     devlib::native::io::FileHandle* writer)
+            : _reader(reader),
+              _writer(writer)
+        { }
+
+        bool readAt(char* data, qint64 size, qint64 offset) override {
+            return devlib::native::io::readAt(_reader, data, size, offset) == size;
+        }
+
+        bool writeAt(char const* data, qint64 size, qint64 offset) override {
+            return devlib::impl::writeAt(_writer, data, size, offset);
+        }
+
+        void sync(void) override {
+            devlib::native::io::sync(_writer);
+        }
+
+    private:
+        devlib::native::io::FileHandle* _reader;
+        devlib::native::io::FileHandle* _writer;
+    };
+}
+
+
+constexpr qint64 devlib::impl::CapacityProbe::BlockSize;
+
+
+devlib::impl::CapacityProbe::CapacityProbe(native::io::FileHandle* reader,
+                                           native::io::FileHandle* writer)
+    : _handles(std::make_unique<HandleDevice>(reader, writer)),
+      _device(_handles.get()),
+      _nonce(std::random_device()() | (quint64(std::random_device()()) << 32))
+{
+    Q_ASSERT(reader);
+    Q_ASSERT(writer);
+}
+
+
+devlib::impl::CapacityProbe::CapacityProbe(ProbeDevice* device)
+    : _device(device),
+      _nonce(std::random_device()() | (quint64(std::random_device()()) << 32))
+{
+    Q_ASSERT(device);
+}
+
+
+auto devlib::impl::CapacityProbe::run(qint64 capacity, int samplesCount,
+                                      bool preserveContents)
+    -> CapacityProbeResult
+{
+    auto result = CapacityProbeResult{ capacity, 0, -1, 0, false };
+
+    auto offsets = sampleOffsets(capacity, samplesCount);
+    if (offsets.empty()) {
+        qWarning() << "Device is too small to probe its capacity";
+        return result;
+    }
+
+    auto count = offsets.size();
+    result.samples = int(count);
+
+    IoBuffer blocks(qint64(count) * BlockSize);
+    auto block = [&blocks] (std::size_t index) { return blocks.data() + index * BlockSize; };
+
+    auto originals = std::unique_ptr<IoBuffer>();
+    if (preserveContents) {
+        originals = std::make_unique<IoBuffer>(qint64(count) * BlockSize);
+
+        for (auto i = std::size_t(0); i < count; i++) {
+            auto data = originals->data() + i * BlockSize;
+            if (!_device->readAt(data, BlockSize, offsets[i])) {
+                qWarning() << "Can not save the block at" << offsets[i];
+                return result;
+            }
+        }
+    }
+
+    // ascending order: an address wrapping onto a lower sample
+    // overwrites that sample's sentinel with its own
+    auto bad = std::vector<bool>(count, false);
+    for (auto i = std::size_t(0); i < count; i++) {
+        makeSentinel(block(i), i);
+        bad[i] = !_device->writeAt(block(i), BlockSize, offsets[i]);
+    }
+    _device->sync();
+
+    for (auto i = std::size_t(0); i < count; i++) {
+        if (!_device->readAt(block(i), BlockSize, offsets[i])) {
+            bad[i] = true;
+            continue;
+        }
+
+        auto found = sentinelIndex(block(i), count);
+        if (found == -1) {
+            bad[i] = true;          // the write was lost
+        } else if (std::size_t(found) != i) {
+            bad[std::size_t(found)] = true; // that address aliases this one
+        }
+    }
+
+    auto restored = true;
+    if (originals) {
+        for (auto i = std::size_t(0); i < count; i++) {
+            restored = _device->writeAt(originals->data() + i * BlockSize,
+                                        BlockSize, offsets[i]) && restored;
+        }
+        _device->sync();
+    }
+
+    auto firstBad = std::find(bad.cbegin(), bad.cend(), true);
+    if (firstBad == bad.cend()) {
+        result.verifiedCapacity = capacity;
+    } else {
+        auto index = std::size_t(firstBad - bad.cbegin());
+        result.firstBadOffset = offsets[index];
+        result.verifiedCapacity = index > 0 ? offsets[index - 1] + BlockSize : 0;
+    }
+
+    if (!restored) {
+        qWarning() << "Not every probed block could be restored";
+    }
+    result.completed = restored;
+
+    return result;
+}
+
+
+// Evenly spread from the first MiB to the very last block, plus the
+// aliases of each of them, ascending
+auto devlib::impl::CapacityProbe::sampleOffsets(qint64 capacity, int samplesCount) const
+    -> std::vector<qint64>
+{
+    auto offsets = std::vector<qint64>();
+
+    auto first = Probe_firstOffset / BlockSize;
+    auto last = capacity / BlockSize - 1;
+    if (samplesCount < 2 || last <= first) {
+        return offsets;
+    }
+
+    for (auto i = 0; i < samplesCount; i++) {
+        auto offset = (first + (last - first) * i / (samplesCount - 1)) * BlockSize;
+        offsets.push_back(offset);
+
+        for (auto size = Probe_minAliasedSize; size < capacity; size *= 2) {
+            if (offset >= size && offset % size >= Probe_firstOffset) {
+                offsets.push_back(offset % size);
+            }
+        }
+    }
+
+    std::sort(offsets.begin(), offsets.end());
+    offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+
+    return offsets;
+}
+
+
+void devlib::impl::CapacityProbe::makeSentinel(char* data, quint64 index) const
+{
+    std::memcpy(data, Probe_magic, sizeof(Probe_magic));
+    std::memcpy(data + 8, &_nonce, sizeof(_nonce));
+    std::memcpy(data + 16, &index, sizeof(index));
+
+    fillPseudoRandom(data + Probe_headerSize, BlockSize - Probe_headerSize,
+                     _nonce ^ (index * 0x9E3779B97F4A7C15ull));
+}
+
+
+auto devlib::impl::CapacityProbe::sentinelIndex(char const* data,
+                                                std::size_t samplesCount) const
+    -> qint64
+{
+    auto nonce = quint64(0);
+    auto index = quint64(0);
+    std::memcpy(&nonce, data + 8, sizeof(nonce));
+    std::memcpy(&index, data + 16, sizeof(index));
+
+    if (std::memcmp(data, Probe_magic, sizeof(Probe_magic)) != 0
+            || nonce != _nonce || index >= samplesCount) {
+        return -1;
+    }
+
+    // the header alone survives on cards that keep only the first bytes
+    char expected[BlockSize];
+    makeSentinel(expected, index);
+
+    return std::memcmp(data, expected, BlockSize) == 0 ? qint64(index) : -1;
+}
+
@@ -0,0 +1,65 @@
+#ifndef CAPACITYPROBE_H
+#define CAPACITYPROBE_H
+
+#include "../StorageDeviceFile.h"
+#include "../native/native.h"
+
+#include <memory>
+#include <vector>
+
+namespace devlib {
+    namespace impl {
+        class CapacityProbe;
+        class ProbeDevice;
+    }
+}
+
+
+// Blocks the probe reads and writes. On a card these are two handles,
+// the reader past the page cache; tests put a simulated card behind it.
+class devlib::impl::ProbeDevice
+{
+public:
+    virtual ~ProbeDevice(void) = default;
+
+    virtual bool readAt(char* data, qint64 size, qint64 offset) = 0;
+    virtual bool writeAt(char const* data, qint64 size, qint64 offset) = 0;
+    virtual void sync(void) = 0;
+};
+
+
+// Fake-capacity cards map addresses past their real size onto lower
+// blocks or drop the writes. A unique sentinel block is written at
+// sampled offsets across the reported capacity and read back past the
+// page cache: a sentinel found at another sample's offset, or not found
+// at its own, marks the address as not backed by real storage.
+// Evenly spread samples hardly ever hit each other's wrap-around
+// address, so every sample brings its aliases along: its offset modulo
+// each power of two below the capacity, where a card that drops the
+// high address bits stores it.
+class devlib::impl::CapacityProbe
+{
+public:
+    static constexpr auto BlockSize = qint64(4096);
+
+    CapacityProbe(native::io::FileHandle* reader, native::io::FileHandle* writer);
+    explicit CapacityProbe(ProbeDevice* device);
+
+    auto run(qint64 capacity, int samplesCount, bool preserveContents)
+        -> CapacityProbeResult;
+
+private:
+    auto sampleOffsets(qint64 capacity, int samplesCount) const
+        -> std::vector<qint64>;
+
+    void makeSentinel(char* data, quint64 index) const;
+
+    // sample index the block is the sentinel of, -1 for anything else
+    auto sentinelIndex(char const* data, std::size_t samplesCount) const -> qint64;
+
+    std::unique_ptr<ProbeDevice> _handles;
+    ProbeDevice* _device;
+    quint64 _nonce;
+};
+
+#endif // CAPACITYPROBE_H
@@ -0,0 +1,347 @@
+#include "DeviceBackup.h"
+#include "IoBuffer.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+#ifdef DEVLIB_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+    constexpr auto Backup_chunkSize = qint64(4) * 1024 * 1024;
+    constexpr auto Backup_readAhead = 4;
+    constexpr auto Backup_bmapChecksumPlaceholder = 64;
+
+
+    bool isZero(char const* data, qint64 size) {
+        return size == 0
+            || (data[0] == 0 && std::memcmp(data, data + 1, size - 1) == 0);
+    }
+
+
+    class ImageSink
+    {
+    public:
+        virtual ~ImageSink(void) = default;
+
+        // consecutive ranges of the image, `zero` if all of it is zeroes
+        virtual bool write(qint64 offset, char const* data, qint64 size, bool zero) = 0;
+        virtual bool finish(qint64 imageSize) = 0;
+    };
+
+
+    // Zero ranges are never written, so they stay holes in the file
+    class SparseRawSink : public ImageSink
+    {
+    public:
+        explicit SparseRawSink(QFile& file) : _file(file) { }
+
+        bool write(qint64 offset, char const* data, qint64 size, bool zero) override {
+            if (zero) {
+                return true;
+            }
+
+            if (_file.pos() != offset && !_file.seek(offset)) {
+                return false;
+            }
+            return _file.write(data, size) == size;
+        }
+
+        bool finish(qint64 imageSize) override {
+            // trailing zeroes are a hole as well
+            return _file.resize(imageSize);
+        }
+
+    private:
+        QFile& _file;
+    };
+
+
+#ifdef DEVLIB_WITH_ZSTD
+    // zstd copies consumed input into its job buffers, so the chunk
+    // buffer can be reused as soon as write() returns while zstd's
+    // workers keep compressing
+    class ZstdSink : public ImageSink
+    {
+    public:
+        ZstdSink(QFile& file, int level, int threads)
+            : _file(file),
+              _context(::ZSTD_createCCtx(), &::ZSTD_freeCCtx),
+              _output(::ZSTD_CStreamOutSize(), Qt::Uninitialized)
+        {
+            ::ZSTD_CCtx_setParameter(_context.get(), ZSTD_c_compressionLevel, level);
+
+            // fails on a single-threaded libzstd, which then compresses inline
+            ::ZSTD_CCtx_setParameter(_context.get(), ZSTD_c_nbWorkers, threads);
+        }
+
+        bool write(qint64 offset, char const* data, qint64 size, bool zero) override {
+            Q_UNUSED(offset); Q_UNUSED(zero);
+
+            auto input = ZSTD_inBuffer{ data, std::size_t(size), 0 };
+            auto remaining = std::size_t(0);
+
+            while (input.pos < input.size) {
+                if (!compress(&input, ZSTD_e_continue, &remaining)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool finish(qint64 imageSize) override {
+            Q_UNUSED(imageSize);
+
+            auto input = ZSTD_inBuffer{ nullptr, 0, 0 };
+            auto remaining = std::size_t(1);
+
+            while (remaining != 0) {
+                if (!compress(&input, ZSTD_e_end, &remaining)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        // `remaining`: bytes zstd still holds back, 0 once a frame is flushed
+        bool compress(ZSTD_inBuffer* input, ZSTD_EndDirective directive,
+                      std::size_t* remaining)
+        {
+            auto output = ZSTD_outBuffer{ _output.data(), std::size_t(_output.size()), 0 };
+            *remaining = ::ZSTD_compressStream2(_context.get(), &output, input, directive);
+
+            if (::ZSTD_isError(*remaining)) {
+                qWarning() << "zstd:" << ::ZSTD_getErrorName(*remaining);
+                return false;
+            }
+            return _file.write(_output.constData(), output.pos) == qint64(output.pos);
+        }
+
+        QFile& _file;
+        std::unique_ptr<ZSTD_CCtx, decltype(&::ZSTD_freeCCtx)> _context;
+        QByteArray _output;
+    };
+#endif
+}
+
+
+constexpr qint64 devlib::impl::DeviceBackup::BlockSize;
+
+
+devlib::impl::DeviceBackup::DeviceBackup(QString const& devicePath,
+                                         BackupOptions const& options,
+                                         Placement const& placement)
+    : _devicePath(devicePath),
+      _options(options),
+      _placement(placement)
+{ }
+
+
+auto devlib::impl::DeviceBackup::run(QString const& imagePath, qint64 length)
+    -> BackupResult
+{
+    auto result = BackupResult{ 0, 0, false };
+    _mappedBlocks.clear();
+
+#ifndef DEVLIB_WITH_ZSTD
+    if (_options.compress) {
+        qWarning() << "devlib is built without zstd, use CONFIG+=DEVLIB_WITH_ZSTD";
+        return result;
+    }
+#endif
+
+    // nobody mounts the device while it is read
+    auto device = native::io::openDirect(_devicePath.toStdString().data(), true);
+    if (!device) {
+        return result;
+    }
+
+    QFile image(imagePath);
+    if (!image.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Can not open" << imagePath << ":" << image.errorString();
+        return result;
+    }
+
+    auto sink = std::unique_ptr<ImageSink>();
+#ifdef DEVLIB_WITH_ZSTD
+    if (_options.compress) {
+        auto threads = _options.compressionThreads > 0 ?
+            _options.compressionThreads : QThread::idealThreadCount();
+        sink = std::make_unique<ZstdSink>(image, _options.compressionLevel, threads);
+    }
+#endif
+    if (!sink) {
+        sink = std::make_unique<SparseRawSink>(image);
+    }
+
+    struct Pending {
+        std::size_t slot;
+        qint64 offset;
+        qint64 length;
+        std::future<qint64> read;
+    };
+
+    auto buffers = std::vector<IoBuffer>();
+    for (auto i = 0; i < Backup_readAhead; i++) {
+        buffers.emplace_back(Backup_chunkSize, _placement.node);
+    }
+
+    auto failed = false;
+    auto endOfDevice = false;
+
+    {
+        WorkerPool reader(1, placementSetup(_placement, "backup-read", _devicePath));
+        auto pending = std::deque<Pending>();
+        auto nextOffset = qint64(0);
+
+        auto submitRead = [&] (std::size_t slot) {
+            if (endOfDevice || (length > 0 && nextOffset >= length)) {
+                return;
+            }
+
+            auto chunkLength = length > 0 ?
+                std::min(Backup_chunkSize, length - nextOffset) : Backup_chunkSize;
+            auto handle = device.get();
+            auto data = buffers[slot].data();
+            auto offset = nextOffset;
+
+            pending.push_back({ slot, offset, chunkLength, reader.submit(
+                [handle, data, offset, chunkLength] () {
+                    return native::io::readAt(handle, data,
+                                              IoBuffer::alignUp(chunkLength), offset);
+                })
+            });
+            nextOffset += chunkLength;
+        };
+
+        for (auto slot = std::size_t(0); slot < buffers.size(); slot++) {
+            submitRead(slot);
+        }
+
+        while (!pending.empty()) {
+            auto chunk = std::move(pending.front());
+            pending.pop_front();
+
+            auto read = chunk.read.get();
+            if (failed || endOfDevice) {
+                continue;
+            }
+            if (read < 0) {
+                failed = true;
+                continue;
+            }
+
+            auto available = std::min(read, chunk.length);
+            endOfDevice = available < chunk.length;
+
+            // runs of zero / non-zero blocks
+            auto data = buffers[chunk.slot].data();
+            for (auto start = qint64(0); start < available && !failed; ) {
+                auto zero = isZero(data + start, std::min(BlockSize, available - start));
+                auto end = start;
+
+                while (end < available) {
+                    auto blockSize = std::min(BlockSize, available - end);
+                    if (isZero(data + end, blockSize) != zero) {
+                        break;
+                    }
+                    end += blockSize;
+                }
+
+                auto offset = chunk.offset + start;
+                failed = !sink->write(offset, data + start, end - start, zero);
+                if (!zero) {
+                    mapRange(offset, end - start);
+                    result.mappedSize += end - start;
+                }
+                start = end;
+            }
+
+            result.size += available;
+            submitRead(chunk.slot);
+        }
+    }
+
+    if (failed || !sink->finish(result.size)) {
+        qWarning() << "Backup of" << _devicePath << "failed at" << result.size;
+        return result;
+    }
+
+    if (length > 0 && result.size != length) {
+        qWarning() << "Device ended after" << result.size << "bytes";
+        return result;
+    }
+
+    image.close();
+    result.ok = _options.bmapPath.isEmpty() || writeBmap(result.size);
+
+    return result;
+}
+
+
+void devlib::impl::DeviceBackup::mapRange(qint64 offset, qint64 size)
+{
+    auto first = offset / BlockSize;
+    auto last = (offset + size - 1) / BlockSize;
+
+    if (!_mappedBlocks.empty() && _mappedBlocks.back().second + 1 >= first) {
+        _mappedBlocks.back().second = std::max(_mappedBlocks.back().second, last);
+    } else {
+        _mappedBlocks.emplace_back(first, last);
+    }
+}
+
+
+// bmaptool 2.0 format. Ranges carry no data checksums, the bmap itself
+// is checksummed the way bmaptool checks it: SHA256 of the file with
+// the checksum field zeroed.
+bool devlib::impl::DeviceBackup::writeBmap(qint64 imageSize) const
+{
+    auto mappedCount = qint64(0);
+    auto ranges = QString();
+
+    for (auto const& range : _mappedBlocks) {
+        mappedCount += range.second - range.first + 1;
+
+        ranges += range.first == range.second ?
+            QString("        <Range> %1 </Range>\n").arg(range.first) :
+            QString("        <Range> %1-%2 </Range>\n").arg(range.first).arg(range.second);
+    }
+
+    auto placeholder = QString(Backup_bmapChecksumPlaceholder, QChar('0'));
+    auto bmap = QString(
+        "<?xml version=\"1.0\" ?>\n"
+        "<bmap version=\"2.0\">\n"
+        "    <ImageSize> %1 </ImageSize>\n"
+        "    <BlockSize> %2 </BlockSize>\n"
+        "    <BlocksCount> %3 </BlocksCount>\n"
+        "    <MappedBlocksCount> %4 </MappedBlocksCount>\n"
+        "    <ChecksumType> sha256 </ChecksumType>\n"
+        "    <BmapFileChecksum> %5 </BmapFileChecksum>\n"
+        "    <BlockMap>\n"
+        "%6"
+        "    </BlockMap>\n"
+        "</bmap>\n"
+    ).arg(imageSize)
+     .arg(BlockSize)
+     .arg((imageSize + BlockSize - 1) / BlockSize)
+     .arg(mappedCount)
+     .arg(placeholder)
+     .arg(ranges).toUtf8();
+
+    auto checksum = QCryptographicHash::hash(bmap, QCryptographicHash::Sha256).toHex();
+    bmap.replace(placeholder.toUtf8(), checksum);
+
+    QFile file(_options.bmapPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || file.write(bmap) != bmap.size()) {
+        qWarning() << "Can not write bmap" << _options.bmapPath << ":" << file.errorString();
+        return false;
+    }
+
+    return true;
+}
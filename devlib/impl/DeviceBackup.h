@@ -0,0 +1,48 @@
+#ifndef DEVICEBACKUP_H
+#define DEVICEBACKUP_H
+
+#include "../StorageDeviceFile.h"
+#include "../native/native.h"
+#include "Placement.h"
+
+#include <utility>
+#include <vector>
+
+namespace devlib {
+    namespace impl {
+        class DeviceBackup;
+    }
+}
+
+
+// Device -> image file pipeline. One worker reads ahead into a fixed
+// set of buffers while the calling thread scans them for zero blocks
+// and feeds the output: a sparse raw image (zero blocks become holes)
+// or a zstd stream compressed by zstd's own worker threads.
+class devlib::impl::DeviceBackup
+{
+public:
+    static constexpr auto BlockSize = qint64(4096);
+
+    // the reader and the read-ahead buffers follow `placement`
+    DeviceBackup(QString const& devicePath, BackupOptions const& options,
+                 Placement const& placement = {});
+
+    // `length` bytes from the device start, up to the device end if 0
+    auto run(QString const& imagePath, qint64 length) -> BackupResult;
+
+private:
+    // adds a non-zero range to the block map, merging neighbours
+    void mapRange(qint64 offset, qint64 size);
+
+    bool writeBmap(qint64 imageSize) const;
+
+    QString _devicePath;
+    BackupOptions _options;
+    Placement _placement;
+
+    // inclusive block ranges holding data
+    std::vector<std::pair<qint64, qint64>> _mappedBlocks;
+};
+
+#endif // DEVICEBACKUP_H
@@ -0,0 +1,230 @@
+#include "DeviceCloner.h"
+#include "IoBuffer.h"
+#include "../native/native.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace {
+    constexpr auto Clone_chunkSize = qint64(4) * 1024 * 1024;
+    constexpr auto Clone_buffersCount = 8;
+    constexpr auto Clone_tailSize = qint64(1024) * 1024;
+
+
+    struct Chunk {
+        qint64 offset;
+        qint64 length;
+        std::shared_ptr<devlib::impl::IoBuffer> buffer;
+    };
+
+
+    class ChunkQueue
+    {
+    public:
+        void push(Chunk chunk) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _chunks.push_back(std::move(chunk));
+            }
+            _wakeup.notify_one();
+        }
+
+        void close(void) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _closed = true;
+            }
+            _wakeup.notify_one();
+        }
+
+        // false once the queue is closed and drained
+        bool pop(Chunk* chunk) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeup.wait(lock, [this] () { return _closed || !_chunks.empty(); });
+
+            if (_chunks.empty()) {
+                return false;
+            }
+
+            *chunk = std::move(_chunks.front());
+            _chunks.pop_front();
+            return true;
+        }
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+        std::deque<Chunk> _chunks;
+        bool _closed = false;
+    };
+
+
+    struct Target {
+        devlib::IStorageDeviceFile* file;
+        devlib::impl::Placement placement;
+        ChunkQueue queue;
+        qint64 written = 0;
+        bool failed = false;
+        std::thread thread;
+    };
+
+
+    // Failed targets keep draining their queue, so they never hold
+    // buffers the others are waiting for
+    void writeChunks(Target* target) {
+        auto chunk = Chunk();
+        auto position = qint64(-1);
+
+        devlib::impl::placeCurrentThread(target->placement, "clone-write",
+                                         target->file->fileName());
+
+        while (target->queue.pop(&chunk)) {
+            if (target->failed) {
+                chunk.buffer.reset();
+                continue;
+            }
+
+            if (position != chunk.offset && !target->file->seek(chunk.offset)) {
+                target->failed = true;
+            } else {
+                target->failed =
+                    target->file->write(chunk.buffer->data(), chunk.length) != chunk.length;
+            }
+
+            if (target->failed) {
+                qWarning() << "Clone to" << target->file->fileName()
+                           << "failed at" << chunk.offset;
+            } else {
+                target->written += chunk.length;
+                position = chunk.offset + chunk.length;
+            }
+
+            chunk.buffer.reset();
+        }
+    }
+}
+
+
+devlib::impl::DeviceCloner::DeviceCloner(QString const& sourcePath,
+                                         std::vector<Range> ranges,
+                                         AffinityPolicy const& affinity)
+    : _sourcePath(sourcePath),
+      _ranges(std::move(ranges)),
+      _affinity(affinity)
+{ }
+
+
+auto devlib::impl::DeviceCloner::run(std::vector<IStorageDeviceFile*> const& targets)
+    -> std::vector<qint64>
+{
+    auto results = std::vector<qint64>(targets.size(), -1);
+
+    // exclusive: nothing can mount the source while it is copied
+    auto source = native::io::openDirect(_sourcePath.toStdString().data(), true);
+    if (!source) {
+        return results;
+    }
+
+    // declared first, so it outlives every chunk of the targets
+    IoBufferPool pool(Clone_buffersCount, Clone_chunkSize,
+                      resolvePlacement(_affinity, _sourcePath).node);
+
+    auto writers = std::vector<std::unique_ptr<Target>>();
+    for (auto file : targets) {
+        writers.push_back(std::make_unique<Target>());
+        writers.back()->file = file;
+        writers.back()->placement = resolvePlacement(_affinity, file->fileName());
+    }
+    for (auto& writer : writers) {
+        writer->thread = std::thread(writeChunks, writer.get());
+    }
+
+    auto readFailed = false;
+    for (auto const& range : _ranges) {
+        auto end = range.second < 0 ?
+            std::numeric_limits<qint64>::max() : range.first + range.second;
+        auto endOfDevice = false;
+
+        for (auto offset = range.first; offset < end && !endOfDevice && !readFailed; ) {
+            auto length = std::min(Clone_chunkSize, end - offset);
+            auto buffer = pool.acquire();
+
+            auto read = native::io::readAt(source.get(), buffer->data(),
+                                           IoBuffer::alignUp(length), offset);
+            if (read < 0) {
+                readFailed = true;
+                break;
+            }
+
+            auto available = std::min(read, length);
+            endOfDevice = available < length;
+
+            if (available > 0) {
+                for (auto& writer : writers) {
+                    writer->queue.push({ offset, available, buffer });
+                }
+            }
+            offset += available;
+        }
+
+        if (readFailed) {
+            qWarning() << "Can not read clone source" << _sourcePath;
+            break;
+        }
+    }
+
+    for (auto& writer : writers) {
+        writer->queue.close();
+    }
+
+    for (auto i = std::size_t(0); i < writers.size(); i++) {
+        writers[i]->thread.join();
+
+        if (!readFailed && !writers[i]->failed) {
+            results[i] = writers[i]->written;
+        }
+    }
+
+    return results;
+}
+
+
+auto devlib::impl::DeviceCloner::allocatedRanges(qint64 length, std::vector<Range> partitions)
+    -> std::vector<Range>
+{
+    std::sort(partitions.begin(), partitions.end());
+
+    auto candidates = std::vector<Range>();
+    auto firstStart = partitions.empty() ? length : partitions.front().first;
+
+    candidates.emplace_back(0, firstStart);
+    candidates.insert(candidates.end(), partitions.cbegin(), partitions.cend());
+    candidates.emplace_back(std::max(qint64(0), length - Clone_tailSize),
+                            std::min(length, Clone_tailSize));
+
+    std::sort(candidates.begin(), candidates.end());
+
+    // clamp to the disk and merge overlapping or touching ranges
+    auto ranges = std::vector<Range>();
+    for (auto const& candidate : candidates) {
+        auto start = std::min(candidate.first, length);
+        auto end = std::min(candidate.first + candidate.second, length);
+
+        if (end <= start) {
+            continue;
+        }
+
+        if (!ranges.empty() && ranges.back().first + ranges.back().second >= start) {
+            auto& last = ranges.back();
+            last.second = std::max(last.first + last.second, end) - last.first;
+        } else {
+            ranges.emplace_back(start, end - start);
+        }
+    }
+
+    return ranges;
+}
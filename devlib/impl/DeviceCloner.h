@@ -0,0 +1,47 @@
+#ifndef DEVICECLONER_H
+#define DEVICECLONER_H
+
+#include "../StorageDeviceFile.h"
+#include "Placement.h"
+
+#include <utility>
+#include <vector>
+
+namespace devlib {
+    namespace impl {
+        class DeviceCloner;
+    }
+}
+
+
+// Reads the source once and fans every chunk out to all targets.
+// Chunks live in a small IoBufferPool and are shared by reference,
+// a buffer is reused once the slowest target has written it; so the
+// reader runs at most a pool ahead of the slowest target.
+class devlib::impl::DeviceCloner
+{
+public:
+    using Range = std::pair<qint64, qint64>; // offset, size; size -1 up to the end
+
+    // Writer threads follow `affinity` resolved per target, the chunk
+    // buffers live on the source's node
+    DeviceCloner(QString const& sourcePath, std::vector<Range> ranges,
+                 AffinityPolicy const& affinity = {});
+
+    // Targets have to be opened for writing. Per target: bytes written,
+    // -1 if the target failed or the source could not be read.
+    auto run(std::vector<IStorageDeviceFile*> const& targets) -> std::vector<qint64>;
+
+    // Parts of a `length` bytes disk worth copying: everything before
+    // the first partition (partition table, boot loaders), the partitions
+    // and the last MiB, where a GPT keeps its backup copy
+    static auto allocatedRanges(qint64 length, std::vector<Range> partitions)
+        -> std::vector<Range>;
+
+private:
+    QString _sourcePath;
+    std::vector<Range> _ranges;
+    AffinityPolicy _affinity;
+};
+
+#endif // DEVICECLONER_H
@@ -0,0 +1,520 @@
+#include "DeviceRegistry.h"
+#include "MetricsRegistry.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr auto Probe_defaultThreads = 8;
+    constexpr auto Probe_defaultTimeout = std::chrono::milliseconds(5000);
+
+    // a snapshot racing with a stream of events gives up being
+    // consistent after this many tries rather than spinning
+    constexpr auto Snapshot_attempts = 3;
+
+
+    template<typename Entry>
+    auto shareList(std::vector<Entry> list) -> std::shared_ptr<std::vector<Entry> const> {
+        return std::make_shared<std::vector<Entry>>(std::move(list));
+    }
+
+
+    template<typename Entry>
+    auto emptyList(void) -> std::shared_ptr<std::vector<Entry> const> {
+        static auto const empty = shareList(std::vector<Entry>());
+        return empty;
+    }
+}
+
+
+devlib::impl::DeviceRegistry::DeviceRegistry(void)
+    : _monitor(native::makeChangeMonitor()),
+      _backend(native::DiscoveryBackend::Platform),
+      _devicesGeneration(0),
+      _contentsGeneration(0),
+      _mountsGeneration(0),
+      _devicesValid(false),
+      _devices(emptyList<DeviceEntry>()),
+      _probeTimeout(Probe_defaultTimeout),
+      _probeQueue(Probe_defaultThreads)
+{ }
+
+
+auto devlib::impl::DeviceRegistry::devices(void)
+    -> SharedList<DeviceEntry>
+{
+    Lock lock(_mutex);
+    applyChanges();
+
+    return cachedDevices(lock);
+}
+
+
+auto devlib::impl::DeviceRegistry::partitions(QString const& devicePath)
+    -> SharedList<PartitionEntry>
+{
+    Lock lock(_mutex);
+    applyChanges();
+
+    return cachedPartitions(lock, devicePath);
+}
+
+
+auto devlib::impl::DeviceRegistry::mountpoints(QString const& devFilePath)
+    -> SharedList<MountpointEntry>
+{
+    Lock lock(_mutex);
+    applyChanges();
+
+    return cachedMountpoints(lock, devFilePath);
+}
+
+
+auto devlib::impl::DeviceRegistry::snapshot(void)
+    -> StorageSnapshot
+{
+    Lock lock(_mutex);
+
+    for (auto attempt = 1; ; attempt++) {
+        applyChanges();
+
+        auto devicesGeneration = _devicesGeneration;
+        auto contentsGeneration = _contentsGeneration;
+        auto mountsGeneration = _mountsGeneration;
+        auto snapshot = buildSnapshot(lock);
+
+        applyChanges();
+        auto unchanged = devicesGeneration == _devicesGeneration
+            && contentsGeneration == _contentsGeneration
+            && mountsGeneration == _mountsGeneration;
+
+        if (unchanged || attempt == Snapshot_attempts) {
+            return snapshot;
+        }
+    }
+}
+
+
+auto devlib::impl::DeviceRegistry::buildSnapshot(Lock& lock)
+    -> StorageSnapshot
+{
+    auto devices = std::vector<DeviceRecord>();
+    auto partitions = std::vector<PartitionRecord>();
+    auto mountpoints = std::vector<MountpointRecord>();
+
+    auto deviceList = cachedDevices(lock);
+    auto const& deviceEntries = *deviceList;
+    auto probed = probePartitions(lock, deviceEntries);
+    devices.reserve(deviceEntries.size());
+
+    auto appendMountpoint = [&mountpoints] (MountpointEntry const& mntpt) {
+        mountpoints.push_back({ mntpt.first, mntpt.second });
+    };
+
+    for (auto const& deviceEntry : deviceEntries) {
+        auto device = DeviceRecord();
+        device.vid = std::get<0>(deviceEntry);
+        device.pid = std::get<1>(deviceEntry);
+        device.filePath = std::get<2>(deviceEntry);
+        device.usbPortPath = std::get<3>(deviceEntry);
+        device.firstPartition = partitions.size();
+        device.firstMountpoint = mountpoints.size();
+        device.probeTimedOut = !probed.contains(device.filePath);
+
+        auto partList = probed.value(device.filePath, emptyList<PartitionEntry>());
+        auto const& partEntries = *partList;
+        auto partMntpts = std::vector<SharedList<MountpointEntry>>();
+        partMntpts.reserve(partEntries.size());
+
+        for (auto const& partEntry : partEntries) {
+            partMntpts.push_back(cachedMountpoints(lock, partEntry.filePath));
+        }
+
+        // mountpoints of the disk itself, not of any of its partitions
+        auto deviceMntpts = cachedMountpoints(lock, device.filePath);
+        for (auto const& mntpt : *deviceMntpts) {
+            auto ownedByPartition = std::any_of(partMntpts.cbegin(), partMntpts.cend(),
+                [&mntpt] (auto const& mntpts) {
+                    return std::find(mntpts->cbegin(), mntpts->cend(), mntpt) != mntpts->cend();
+                }
+            );
+
+            if (!ownedByPartition) {
+                appendMountpoint(mntpt);
+            }
+        }
+
+        for (auto i = std::size_t(0); i < partEntries.size(); i++) {
+            auto const& partEntry = partEntries.at(i);
+
+            auto partition = PartitionRecord();
+            partition.filePath = partEntry.filePath;
+            partition.label = partEntry.label;
+            partition.fsType = partEntry.fsType;
+            partition.typeId = partEntry.typeId;
+            partition.uuid = partEntry.uuid;
+            partition.name = partEntry.name;
+            partition.start = partEntry.start;
+            partition.size = partEntry.size;
+            partition.firstMountpoint = mountpoints.size();
+            partition.mountpointsCount = partMntpts.at(i)->size();
+
+            std::for_each(partMntpts.at(i)->cbegin(), partMntpts.at(i)->cend(),
+                          appendMountpoint);
+            partitions.push_back(partition);
+        }
+
+        device.partitionsCount = partitions.size() - device.firstPartition;
+        device.mountpointsCount = mountpoints.size() - device.firstMountpoint;
+        devices.push_back(device);
+    }
+
+    return StorageSnapshot(std::move(devices),
+                           std::move(partitions),
+                           std::move(mountpoints));
+}
+
+
+auto devlib::impl::DeviceRegistry::usbTopology(void)
+    -> UsbTopology
+{
+    Lock lock(_mutex);
+    applyChanges();
+
+    auto devices = cachedDevices(lock);
+    if (_devicesValid) {
+        return _topology;
+    }
+
+    // nothing is cached without a change monitor
+    auto topology = UsbTopology();
+    for (auto const& device : *devices) {
+        topology.insert(std::get<3>(device), std::get<2>(device));
+    }
+
+    return topology;
+}
+
+
+void devlib::impl::DeviceRegistry::setProbeLimits(int threadsCount,
+                                                  std::chrono::milliseconds deviceTimeout)
+{
+    Q_ASSERT(threadsCount > 0);
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _probeQueue.setLimit(threadsCount);
+    _probeTimeout = deviceTimeout;
+}
+
+
+void devlib::impl::DeviceRegistry::setDiscoveryBackend(native::DiscoveryBackend backend)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (backend != _backend) {
+        _backend = backend;
+        _devicesValid = false;
+        _devicesGeneration++;
+    }
+}
+
+
+void devlib::impl::DeviceRegistry::rescan(void)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // events queued so far are covered by the rescan
+    if (_monitor) {
+        native::pollChanges(_monitor.get());
+    }
+
+    _devicesValid = false;
+    _devicesGeneration++;
+    _contentsGeneration++;
+    _mountsGeneration++;
+
+    _devices = emptyList<DeviceEntry>();
+    _partitions.clear();
+    _mountpoints.clear();
+
+    for (auto& probe : _pendingProbes) {
+        probe.stale = true;
+    }
+}
+
+
+auto devlib::impl::DeviceRegistry::probePartitions(Lock& lock,
+                                                   std::vector<DeviceEntry> const& devices)
+    -> QHash<QString, SharedList<PartitionEntry>>
+{
+    using Clock = std::chrono::steady_clock;
+    auto results = QHash<QString, SharedList<PartitionEntry>>();
+    auto waiting = std::vector<std::pair<QString, PendingProbe>>();
+
+    // stale probes that returned meanwhile make room for fresh ones
+    for (auto it = _pendingProbes.begin(); it != _pendingProbes.end(); ) {
+        auto returned = it.value().result.wait_for(Clock::duration::zero())
+            == std::future_status::ready;
+
+        if (it.value().stale && returned) {
+            it = _pendingProbes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto const& device : devices) {
+        auto const& path = std::get<2>(device);
+        auto cached = _partitions.constFind(path);
+
+        if (cached != _partitions.cend()) {
+            results.insert(path, cached.value());
+            continue;
+        }
+
+        // only fresh probes are waited for; stale or abandoned ones still
+        // running are reported as timed out at once, an abandoned one
+        // that returned meanwhile is used as if it had been in time
+        auto pending = _pendingProbes.find(path);
+        if (pending != _pendingProbes.end()) {
+            auto const& probe = pending.value();
+            auto returned = probe.result.wait_for(Clock::duration::zero())
+                == std::future_status::ready;
+
+            if (!probe.stale && !probe.abandoned) {
+                waiting.emplace_back(path, probe);
+            } else if (!probe.stale && returned) {
+                results.insert(path, probe.result.get());
+                if (_monitor) {
+                    _partitions.insert(path, probe.result.get());
+                }
+                _pendingProbes.erase(pending);
+            }
+            continue;
+        }
+
+        auto task = std::make_shared<std::packaged_task<SharedList<PartitionEntry>()>>(
+            [path] () { return shareList(native::devicePartitions(path)); }
+        );
+
+        auto probe = PendingProbe();
+        probe.result = task->get_future().share();
+        probe.handle = _probeQueue.submit([task] () { (*task)(); });
+        probe.stale = false;
+        probe.abandoned = false;
+
+        _pendingProbes.insert(path, probe);
+        waiting.emplace_back(path, probe);
+    }
+
+    // one deadline for the whole call, whether the probes run or still
+    // wait for a free slot
+    auto deadline = Clock::now() + _probeTimeout;
+    auto finished = std::vector<std::pair<QString, PendingProbe>>();
+    auto timedOut = std::vector<std::pair<QString, PendingProbe>>();
+    lock.unlock();
+
+    for (auto const& entry : waiting) {
+        if (entry.second.result.wait_until(deadline) == std::future_status::ready) {
+            results.insert(entry.first, entry.second.result.get());
+            finished.push_back(entry);
+        } else {
+            qWarning() << "Partitions probe of" << entry.first << "timed out";
+            timedOut.push_back(entry);
+        }
+    }
+
+    lock.lock();
+
+    // hung devices stop holding slots, their threads are left behind;
+    // probes still queued behind them are waited for again next time
+    for (auto const& entry : timedOut) {
+        if (!_probeQueue.abandon(entry.second.handle)) {
+            continue;
+        }
+
+        auto pending = _pendingProbes.find(entry.first);
+        if (pending != _pendingProbes.end()
+                && pending.value().handle == entry.second.handle) {
+            pending.value().abandoned = true;
+        }
+    }
+
+    // a probe made stale by an event meanwhile is returned, not cached
+    for (auto const& entry : finished) {
+        auto pending = _pendingProbes.find(entry.first);
+        if (pending == _pendingProbes.end()
+                || pending.value().handle != entry.second.handle) {
+            continue;
+        }
+
+        auto stale = pending.value().stale;
+        _pendingProbes.erase(pending);
+
+        if (_monitor && !stale) {
+            _partitions.insert(entry.first, entry.second.result.get());
+        }
+    }
+
+    return results;
+}
+
+
+auto devlib::impl::DeviceRegistry::cachedDevices(Lock& lock)
+    -> SharedList<DeviceEntry>
+{
+    if (_devicesValid) {
+        return _devices;
+    }
+
+    auto generation = _devicesGeneration;
+    auto backend = _backend;
+
+    lock.unlock();
+    auto devices = shareList(native::requestUsbDeviceList(backend));
+
+    auto paths = std::vector<QString>();
+    for (auto const& device : *devices) {
+        paths.push_back(std::get<2>(device));
+    }
+    MetricsRegistry::instance().sawDevices(paths);
+    lock.lock();
+
+    applyChanges();
+    if (_monitor && generation == _devicesGeneration && !_devicesValid) {
+        _devices = devices;
+        _devicesValid = true;
+        resetTopology(*_devices);
+    }
+
+    return devices;
+}
+
+
+auto devlib::impl::DeviceRegistry::cachedPartitions(Lock& lock, QString const& devicePath)
+    -> SharedList<PartitionEntry>
+{
+    auto cached = _partitions.constFind(devicePath);
+    if (cached != _partitions.cend()) {
+        return cached.value();
+    }
+
+    auto generation = _contentsGeneration;
+
+    lock.unlock();
+    auto partitions = shareList(native::devicePartitions(devicePath));
+    lock.lock();
+
+    applyChanges();
+    if (_monitor && generation == _contentsGeneration) {
+        _partitions.insert(devicePath, partitions);
+    }
+
+    return partitions;
+}
+
+
+auto devlib::impl::DeviceRegistry::cachedMountpoints(Lock& lock, QString const& devFilePath)
+    -> SharedList<MountpointEntry>
+{
+    auto cached = _mountpoints.constFind(devFilePath);
+    if (cached != _mountpoints.cend()) {
+        return cached.value();
+    }
+
+    auto generation = _contentsGeneration;
+    auto mountsGeneration = _mountsGeneration;
+
+    lock.unlock();
+    auto mntpts = shareList(native::mntptsForPartition(devFilePath));
+    lock.lock();
+
+    applyChanges();
+    if (_monitor && generation == _contentsGeneration
+            && mountsGeneration == _mountsGeneration) {
+        _mountpoints.insert(devFilePath, mntpts);
+    }
+
+    return mntpts;
+}
+
+
+void devlib::impl::DeviceRegistry::resetTopology(std::vector<DeviceEntry> const& devices)
+{
+    _topology = UsbTopology();
+    for (auto const& device : devices) {
+        _topology.insert(std::get<3>(device), std::get<2>(device));
+    }
+}
+
+
+void devlib::impl::DeviceRegistry::applyChanges(void)
+{
+    if (!_monitor) {
+        return;
+    }
+
+    for (auto const& event : native::pollChanges(_monitor.get())) {
+        applyChange(event);
+    }
+}
+
+
+void devlib::impl::DeviceRegistry::applyChange(native::ChangeEvent const& event)
+{
+    switch (event.kind) {
+    case native::ChangeKind::Device:
+        _devicesGeneration++;
+        _contentsGeneration++;
+        markProbeStale(event.devicePath);
+
+        // handed out lists stay as they are, a changed one replaces them
+        if (event.action == "remove" || event.action == "add") {
+            auto devices = *_devices;
+            auto removed = std::remove_if(devices.begin(), devices.end(),
+                [&event] (auto const& device) {
+                    return std::get<2>(device) == event.devicePath;
+                }
+            );
+            devices.erase(removed, devices.end());
+            _topology.remove(event.devicePath);
+
+            if (event.action == "add") {
+                MetricsRegistry::instance().deviceAdded(event.devicePath);
+            } else {
+                MetricsRegistry::instance().deviceRemoved(event.devicePath);
+            }
+            if (event.action == "add" && _devicesValid) {
+                devices.emplace_back(event.vid, event.pid,
+                                     event.devicePath, event.usbPortPath);
+                _topology.insert(event.usbPortPath, event.devicePath);
+            }
+            _devices = shareList(std::move(devices));
+        }
+        // partition table might be rewritten on "change"
+        _partitions.remove(event.devicePath);
+        _mountpoints.remove(event.devicePath);
+        break;
+
+    case native::ChangeKind::Partition:
+        _contentsGeneration++;
+        markProbeStale(event.parentPath);
+        _partitions.remove(event.parentPath);
+        _mountpoints.remove(event.devicePath);
+        break;
+
+    // partition tables and probes in flight are not affected
+    case native::ChangeKind::MountTable:
+        _mountsGeneration++;
+        _mountpoints.clear();
+        break;
+    }
+}
+
+
+void devlib::impl::DeviceRegistry::markProbeStale(QString const& devicePath)
+{
+    auto pending = _pendingProbes.find(devicePath);
+    if (pending != _pendingProbes.end()) {
+        pending.value().stale = true;
+    }
+}
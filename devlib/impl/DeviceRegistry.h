@@ -0,0 +1,127 @@
+#ifndef DEVICEREGISTRY_H
+#define DEVICEREGISTRY_H
+
+#include "../native/native.h"
+#include "../StorageSnapshot.h"
+#include "../UsbTopology.h"
+#include "ProbeQueue.h"
+
+#include <chrono>
+#include <future>
+#include <mutex>
+
+namespace devlib {
+    namespace impl {
+        class DeviceRegistry;
+    }
+}
+
+
+// In-memory cache of native enumeration results.
+// Entries are dropped by kernel uevents and mount table
+// notifications, so repeated queries do not touch the OS.
+//
+// Safe to use from any number of threads. The mutex guards the cache
+// only and is never held across an OS query: a miss is looked up with
+// the lock released and stored afterwards, unless an invalidation
+// (event, rescan, backend switch) happened meanwhile. Two threads
+// missing the same entry may both query the OS.
+class devlib::impl::DeviceRegistry
+{
+public:
+    using DeviceEntry = std::tuple<int, int, QString, QString>;
+    using PartitionEntry = native::PartitionInfo;
+    using MountpointEntry = std::pair<QString, QString>;
+
+    // Lists are immutable once cached and handed out by reference, so a
+    // query costs a reference count, not a copy. Device and partition
+    // handles point into them.
+    template<typename Entry>
+    using SharedList = std::shared_ptr<std::vector<Entry> const>;
+
+    DeviceRegistry(void);
+
+    auto devices(void) -> SharedList<DeviceEntry>;
+
+    auto partitions(QString const& devicePath)
+        -> SharedList<PartitionEntry>;
+
+    auto mountpoints(QString const& devFilePath)
+        -> SharedList<MountpointEntry>;
+
+    // whole tree from one cache generation, rebuilt if it was
+    // invalidated halfway, so it is consistent
+    auto snapshot(void) -> StorageSnapshot;
+
+    // kept current by hotplug events, not rebuilt per query
+    auto usbTopology(void) -> UsbTopology;
+
+    // drop everything, next query goes to the OS
+    void rescan(void);
+
+    // snapshot() probes partition tables of up to `threadsCount` devices
+    // at once and waits `deviceTimeout` at most, counted from the call.
+    // Devices that did not answer by then are reported as timed out;
+    // their probes keep running but no longer count toward
+    // `threadsCount`. Later queries report them as timed out at once,
+    // without waiting, until the probe returns.
+    void setProbeLimits(int threadsCount, std::chrono::milliseconds deviceTimeout);
+
+    // device list is requested again through the new backend
+    void setDiscoveryBackend(native::DiscoveryBackend backend);
+
+private:
+    struct PendingProbe {
+        std::shared_future<SharedList<PartitionEntry>> result;
+        ProbeQueue::Handle handle;
+        // the device changed after the probe was submitted: its result
+        // is dropped, but the entry stays until the probe returns, so
+        // the device is never probed twice at once
+        bool stale;
+        // timed out once: reported as timed out without waiting until
+        // it returns, its result is used then
+        bool abandoned;
+    };
+
+    using Lock = std::unique_lock<std::mutex>;
+
+    // the lock is released while waiting for probes or the OS
+    auto buildSnapshot(Lock& lock) -> StorageSnapshot;
+    auto probePartitions(Lock& lock, std::vector<DeviceEntry> const& devices)
+        -> QHash<QString, SharedList<PartitionEntry>>;
+
+    auto cachedDevices(Lock& lock) -> SharedList<DeviceEntry>;
+    auto cachedPartitions(Lock& lock, QString const& devicePath)
+        -> SharedList<PartitionEntry>;
+    auto cachedMountpoints(Lock& lock, QString const& devFilePath)
+        -> SharedList<MountpointEntry>;
+
+    void resetTopology(std::vector<DeviceEntry> const& devices);
+
+    void applyChanges(void);
+    void applyChange(native::ChangeEvent const& event);
+    void markProbeStale(QString const& devicePath);
+
+    std::mutex _mutex;
+    std::unique_ptr<native::ChangeMonitor> _monitor;
+
+    native::DiscoveryBackend _backend;
+
+    // bumped on every invalidation, results of OS queries started
+    // under an older value are returned but not cached
+    quint64 _devicesGeneration;
+    quint64 _contentsGeneration;
+    quint64 _mountsGeneration;   // mount table only
+
+    bool _devicesValid;
+    SharedList<DeviceEntry> _devices;
+    UsbTopology _topology;
+    QHash<QString, SharedList<PartitionEntry>> _partitions;
+    QHash<QString, SharedList<MountpointEntry>> _mountpoints;
+
+    std::chrono::milliseconds _probeTimeout;
+    ProbeQueue _probeQueue;
+    QHash<QString, PendingProbe> _pendingProbes;
+};
+
+#endif // DEVICEREGISTRY_H
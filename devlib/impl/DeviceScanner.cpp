@@ -0,0 +1,137 @@
+#include "DeviceScanner.h"
+#include "IoBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace {
+    constexpr auto Scan_requestSize = qint64(8) * 1024 * 1024;
+
+    using Clock = std::chrono::steady_clock;
+
+
+    struct RegionTotals {
+        qint64 readBytes = 0;
+        qint64 writtenBytes = 0;
+        Clock::duration readTime = {};
+        Clock::duration writeTime = {};
+        Clock::duration slowestRead = {};
+        Clock::duration slowestWrite = {};
+
+        void addRead(qint64 bytes, Clock::duration time) {
+            readBytes += bytes;
+            readTime += time;
+            slowestRead = std::max(slowestRead, time);
+        }
+
+        void addWrite(qint64 bytes, Clock::duration time) {
+            writtenBytes += bytes;
+            writeTime += time;
+            slowestWrite = std::max(slowestWrite, time);
+        }
+
+        auto stats(void) const -> devlib::RegionStats {
+            return { megabytesPerSecond(readBytes, readTime),
+                     megabytesPerSecond(writtenBytes, writeTime),
+                     milliseconds(slowestRead),
+                     milliseconds(slowestWrite) };
+        }
+
+        static auto megabytesPerSecond(qint64 bytes, Clock::duration time) -> float {
+            auto seconds = std::chrono::duration<double>(time).count();
+            return seconds > 0 ? float(bytes / 1e6 / seconds) : 0.0f;
+        }
+
+        static auto milliseconds(Clock::duration time) -> float {
+            return float(std::chrono::duration<double, std::milli>(time).count());
+        }
+    };
+
+
+    constexpr auto Scan_patternSeed = quint64(0x9E3779B97F4A7C15ull);
+}
+
+
+devlib::impl::DeviceScanner::DeviceScanner(native::io::FileHandle* reader,
+                                           native::io::FileHandle* writer)
+    : _reader(reader),
+      _writer(writer)
+{
+    Q_ASSERT(reader);
+}
+
+
+auto devlib::impl::DeviceScanner::run(ScanOptions const& options, qint64 length)
+    -> HeatMap
+{
+    Q_ASSERT(options.regionSize > 0);
+    Q_ASSERT(options.mode == ScanMode::Read || _writer);
+
+    auto heatMap = HeatMap{ options.regionSize, {}, false };
+    auto end = length > 0 ? length : std::numeric_limits<qint64>::max();
+
+    if (length > 0) {
+        heatMap.regions.reserve((length + options.regionSize - 1) / options.regionSize);
+    }
+
+    IoBuffer buffer(Scan_requestSize);
+    auto pattern = std::unique_ptr<IoBuffer>();
+
+    if (options.mode == ScanMode::Destructive) {
+        pattern = std::make_unique<IoBuffer>(Scan_requestSize);
+        fillPseudoRandom(pattern->data(), pattern->size(), Scan_patternSeed);
+    }
+
+    auto endOfDevice = false;
+    for (auto regionStart = qint64(0); regionStart < end && !endOfDevice;
+            regionStart += options.regionSize) {
+        auto regionEnd = std::min(end - regionStart, options.regionSize) + regionStart;
+        auto totals = RegionTotals();
+
+        for (auto offset = regionStart; offset < regionEnd && !endOfDevice; ) {
+            auto requestSize = std::min(Scan_requestSize, regionEnd - offset);
+            auto alignedSize = IoBuffer::alignUp(requestSize);
+
+            if (pattern) {
+                auto begin = Clock::now();
+                if (!writeAt(_writer, pattern->data(), requestSize, offset)) {
+                    qWarning() << "Scan write failed at" << offset;
+                    return heatMap;
+                }
+                totals.addWrite(requestSize, Clock::now() - begin);
+            }
+
+            auto begin = Clock::now();
+            auto read = native::io::readAt(_reader, buffer.data(), alignedSize, offset);
+            auto readTime = Clock::now() - begin;
+
+            if (read < 0) {
+                qWarning() << "Scan read failed at" << offset;
+                return heatMap;
+            }
+
+            auto available = std::min(read, requestSize);
+            endOfDevice = available < requestSize;
+            totals.addRead(available, readTime);
+
+            if (options.mode == ScanMode::ReadWrite && available > 0) {
+                auto writeBegin = Clock::now();
+                if (!writeAt(_writer, buffer.data(), available, offset)) {
+                    qWarning() << "Scan write failed at" << offset;
+                    return heatMap;
+                }
+                totals.addWrite(available, Clock::now() - writeBegin);
+            }
+
+            offset += available;
+        }
+
+        if (totals.readBytes > 0) {
+            heatMap.regions.push_back(totals.stats());
+        }
+    }
+
+    heatMap.completed = true;
+    return heatMap;
+}
@@ -0,0 +1,31 @@
+#ifndef DEVICESCANNER_H
+#define DEVICESCANNER_H
+
+#include "../DeviceScan.h"
+#include "../native/native.h"
+
+namespace devlib {
+    namespace impl {
+        class DeviceScanner;
+    }
+}
+
+
+// Sweeps the device with large aligned requests and times each one.
+// Reads go through a cache-bypassing handle, writes through the
+// synchronous handle of the opened device file.
+class devlib::impl::DeviceScanner
+{
+public:
+    // `writer` may be null for ScanMode::Read
+    DeviceScanner(native::io::FileHandle* reader, native::io::FileHandle* writer);
+
+    // `length` bytes from the device start, up to the device end if 0
+    auto run(ScanOptions const& options, qint64 length) -> HeatMap;
+
+private:
+    native::io::FileHandle* _reader;
+    native::io::FileHandle* _writer;
+};
+
+#endif // DEVICESCANNER_H
@@ -0,0 +1,349 @@
+#include "FlashDispatcher.h"
+#include "IoBuffer.h"
+#include "MetricsRegistry.h"
+#include "Placement.h"
+#include "StorageDeviceFileImpl.h"
+#include "../UsbTopology.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr auto Flash_chunkSize = qint64(4) * 1024 * 1024;
+    constexpr auto Flash_initialLimit = 2;
+}
+
+
+devlib::impl::FlashDispatcher::GroupLimit::GroupLimit(int ceiling)
+    : _ceiling(qMax(ceiling, 1)),
+      _limit(qMin(Flash_initialLimit, _ceiling)),
+      _throughputAt(std::size_t(_ceiling) + 2, 0.0)
+{ }
+
+
+void devlib::impl::FlashDispatcher::GroupLimit::started(Clock::time_point now)
+{
+    _running++;
+    restartWindow(now);
+}
+
+
+void devlib::impl::FlashDispatcher::GroupLimit::finished(Clock::time_point now)
+{
+    _running--;
+    restartWindow(now);
+}
+
+
+void devlib::impl::FlashDispatcher::GroupLimit::transferred(qint64 bytes,
+                                                            Clock::time_point now,
+                                                            FlashLimits const& limits)
+{
+    _windowBytes += bytes;
+
+    auto elapsed = now - _windowStart;
+    if (elapsed < limits.sampleWindow) {
+        return;
+    }
+
+    auto seconds = std::chrono::duration<double>(elapsed).count();
+    auto mbps = _windowBytes / 1e6 / seconds;
+    _lastMBps = float(mbps);
+
+    // a group below its limit says nothing about the limit
+    if (_running == _limit) {
+        adapt(mbps, limits.minimalGain);
+    }
+    restartWindow(now);
+}
+
+
+void devlib::impl::FlashDispatcher::GroupLimit::restartWindow(Clock::time_point now)
+{
+    _windowStart = now;
+    _windowBytes = 0;
+}
+
+
+void devlib::impl::FlashDispatcher::GroupLimit::adapt(double mbps, double minimalGain)
+{
+    auto& current = _throughputAt[std::size_t(_limit)];
+    current = current > 0 ? (current + mbps) / 2 : mbps;
+
+    auto fewer = _throughputAt[std::size_t(_limit) - 1];
+    auto more = _throughputAt[std::size_t(_limit) + 1];
+
+    if (fewer > 0 && current < fewer * (1 + minimalGain)) {
+        _limit--;
+    } else if (_limit < _ceiling && (more == 0 || more >= current * (1 + minimalGain))) {
+        _limit++;
+    }
+}
+
+
+devlib::impl::FlashDispatcher::FlashDispatcher(FlashLimits const& limits)
+    : _limits(limits),
+      _nextId(1),
+      _running(0)
+{
+    Q_ASSERT(limits.maxTotal > 0);
+}
+
+
+devlib::impl::FlashDispatcher::~FlashDispatcher(void)
+{
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+
+auto devlib::impl::FlashDispatcher::submit(FlashJob job)
+    -> int
+{
+    auto portPath = job.target->usbPortPath();
+    auto queued = Job{ 0, std::move(job), QString(), QString() };
+
+    if (UsbTopology::isPortPath(portPath)) {
+        queued.hub = UsbTopology::parentOf(portPath);
+        queued.controller = portPath.left(portPath.indexOf('-'));
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    queued.id = _nextId++;
+
+    if (!queued.hub.isEmpty() && !_hubs.contains(queued.hub)) {
+        _hubs.insert(queued.hub, GroupLimit(_limits.maxPerHub));
+    }
+    if (!queued.controller.isEmpty() && !_controllers.contains(queued.controller)) {
+        _controllers.insert(queued.controller, GroupLimit(_limits.maxPerController));
+    }
+
+    auto position = std::upper_bound(_queue.begin(), _queue.end(), queued.job.priority,
+        [] (int priority, Job const& other) { return priority > other.job.priority; }
+    );
+    auto id = queued.id;
+    _queue.insert(position, std::move(queued));
+
+    admit();
+    return id;
+}
+
+
+void devlib::impl::FlashDispatcher::cancelPending(void)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (auto const& job : _queue) {
+        _results.push_back({ job.id, job.job.imagePath, job.job.target->filePath(), 0, false });
+    }
+    _queue.clear();
+
+    if (idle()) {
+        _idle.notify_all();
+    }
+}
+
+
+auto devlib::impl::FlashDispatcher::wait(void)
+    -> std::vector<FlashJobResult>
+{
+    auto threads = std::vector<std::thread>();
+    auto results = std::vector<FlashJobResult>();
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _idle.wait(lock, [this] () { return idle(); });
+
+        threads.swap(_threads);
+        results.swap(_results);
+    }
+
+    // every one of them is past finished() already
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    return results;
+}
+
+
+auto devlib::impl::FlashDispatcher::groups(void) const
+    -> std::vector<FlashGroupStats>
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto stats = std::vector<FlashGroupStats>();
+
+    for (auto it = _controllers.cbegin(); it != _controllers.cend(); ++it) {
+        stats.push_back({ it.key(), true, it->running(), it->limit(), it->throughputMBps() });
+    }
+    for (auto it = _hubs.cbegin(); it != _hubs.cend(); ++it) {
+        stats.push_back({ it.key(), false, it->running(), it->limit(), it->throughputMBps() });
+    }
+
+    std::sort(stats.begin(), stats.end(), [] (auto const& lhs, auto const& rhs) {
+        return lhs.portPath < rhs.portPath;
+    });
+
+    return stats;
+}
+
+
+bool devlib::impl::FlashDispatcher::fits(Job const& job) const
+{
+    if (_busyDevices.contains(job.job.target->filePath())) {
+        return false;
+    }
+
+    auto hub = _hubs.constFind(job.hub);
+    if (hub != _hubs.cend() && !hub->hasRoom()) {
+        return false;
+    }
+
+    auto controller = _controllers.constFind(job.controller);
+    return controller == _controllers.cend() || controller->hasRoom();
+}
+
+
+// Highest priority job which fits, not just the head of the queue:
+// a full hub must not hold back jobs for other hubs
+void devlib::impl::FlashDispatcher::admit(void)
+{
+    auto now = Clock::now();
+
+    for (auto it = _queue.begin(); it != _queue.end() && _running < _limits.maxTotal; ) {
+        if (!fits(*it)) {
+            ++it;
+            continue;
+        }
+
+        auto job = std::move(*it);
+        it = _queue.erase(it);
+
+        _running++;
+        _busyDevices.insert(job.job.target->filePath());
+        if (!job.hub.isEmpty()) {
+            _hubs[job.hub].started(now);
+        }
+        if (!job.controller.isEmpty()) {
+            _controllers[job.controller].started(now);
+        }
+
+        _threads.emplace_back([this, job] () { run(job); });
+    }
+}
+
+
+void devlib::impl::FlashDispatcher::run(Job const& job)
+{
+    auto& metrics = MetricsRegistry::instance();
+    metrics.flashStarted();
+
+    auto written = flash(job.job, [this, &job] (qint64 bytes) {
+        transferred(job, bytes);
+    });
+    metrics.flashFinished(written >= 0);
+
+    finished(job, written);
+}
+
+
+void devlib::impl::FlashDispatcher::transferred(Job const& job, qint64 bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto now = Clock::now();
+
+    if (!job.hub.isEmpty()) {
+        _hubs[job.hub].transferred(bytes, now, _limits);
+    }
+    if (!job.controller.isEmpty()) {
+        _controllers[job.controller].transferred(bytes, now, _limits);
+    }
+
+    // a raised limit makes room right away
+    admit();
+}
+
+
+void devlib::impl::FlashDispatcher::finished(Job const& job, qint64 written)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto now = Clock::now();
+
+    _running--;
+    _busyDevices.remove(job.job.target->filePath());
+    if (!job.hub.isEmpty()) {
+        _hubs[job.hub].finished(now);
+    }
+    if (!job.controller.isEmpty()) {
+        _controllers[job.controller].finished(now);
+    }
+
+    _results.push_back({ job.id, job.job.imagePath, job.job.target->filePath(),
+                         qMax(written, qint64(0)), written >= 0 });
+
+    admit();
+    if (idle()) {
+        _idle.notify_all();
+    }
+}
+
+
+auto devlib::impl::FlashDispatcher::flash(FlashJob const& job,
+                                          std::function<void(qint64)> const& progress)
+    -> qint64
+{
+    auto placement = resolvePlacement(job.affinity, job.target->filePath());
+    placeCurrentThread(placement, "flash", job.target->filePath());
+
+    QFile image(job.imagePath);
+    if (!image.open(QIODevice::ReadOnly)) {
+        qWarning() << "Can not open image" << job.imagePath;
+        return -1;
+    }
+
+    StorageDeviceFileImpl file(job.target->filePath(), job.target);
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+        qWarning() << "Can not open" << job.target->filePath() << "for flashing";
+        return -1;
+    }
+
+    auto written = qint64(0);
+
+    // expanded in one call, so it takes its slot but is not sampled
+    if (IStorageDeviceFile::isSparseImage(image)) {
+        written = file.writeSparseImage(image);
+    } else {
+        IoBuffer buffer(Flash_chunkSize, placement.node);
+
+        for (;;) {
+            auto count = readFully(image, buffer.data(), Flash_chunkSize);
+            if (count <= 0) {
+                break;
+            }
+
+            if (file.write(buffer.data(), count) != count) {
+                qWarning() << "Flashing" << job.target->filePath()
+                           << "failed at" << written;
+                written = -1;
+                break;
+            }
+
+            written += count;
+            progress(count);
+        }
+
+        if (written >= 0 && image.error() != QFileDevice::NoError) {
+            qWarning() << "Can not read image" << job.imagePath;
+            written = -1;
+        }
+    }
+
+    // the last chunks may only fail when flushed
+    if (!file.sync() && written >= 0) {
+        qWarning() << "Can not flush" << job.target->filePath()
+                   << "after writing" << written << "bytes";
+        written = -1;
+    }
+    file.close();
+
+    return written;
+}
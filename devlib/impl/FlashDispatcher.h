@@ -0,0 +1,107 @@
+#ifndef FLASHDISPATCHER_H
+#define FLASHDISPATCHER_H
+
+#include "../FlashScheduler.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace devlib {
+    namespace impl {
+        class FlashDispatcher;
+    }
+}
+
+
+// Queue, admission and the job threads behind FlashScheduler.
+// Every job runs on its own thread; threads are joined by wait().
+class devlib::impl::FlashDispatcher
+{
+public:
+    explicit FlashDispatcher(FlashLimits const& limits);
+    ~FlashDispatcher(void);
+
+    auto submit(FlashJob job) -> int;
+    void cancelPending(void);
+    auto wait(void) -> std::vector<FlashJobResult>;
+    auto groups(void) const -> std::vector<FlashGroupStats>;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Concurrency limit of one hub or controller. Aggregate throughput
+    // is sampled per window while the group runs at its limit; the limit
+    // goes one up while that keeps paying off and one down when the
+    // last admitted job did not add throughput.
+    class GroupLimit
+    {
+    public:
+        GroupLimit(void) = default;
+        explicit GroupLimit(int ceiling);
+
+        bool hasRoom(void) const { return _running < _limit; }
+
+        void started(Clock::time_point now);
+        void finished(Clock::time_point now);
+        void transferred(qint64 bytes, Clock::time_point now, FlashLimits const& limits);
+
+        auto running(void) const { return _running; }
+        auto limit(void) const { return _limit; }
+        auto throughputMBps(void) const { return _lastMBps; }
+
+    private:
+        void restartWindow(Clock::time_point now);
+        void adapt(double mbps, double minimalGain);
+
+        int _ceiling = 1;
+        int _limit = 1;
+        int _running = 0;
+
+        Clock::time_point _windowStart;
+        qint64 _windowBytes = 0;
+        float _lastMBps = 0;
+
+        // MB/s measured at each concurrency level, zero if never run at it
+        std::vector<double> _throughputAt;
+    };
+
+    struct Job {
+        int id;
+        FlashJob job;
+        QString hub;            // empty for non-USB targets
+        QString controller;
+    };
+
+    // all of these expect _mutex to be held
+    bool fits(Job const& job) const;
+    void admit(void);
+    bool idle(void) const { return _queue.empty() && _running == 0; }
+
+    void run(Job const& job);
+    void transferred(Job const& job, qint64 bytes);
+    void finished(Job const& job, qint64 written);
+
+    // bytes written, -1 on failure; `progress` gets every written chunk
+    static auto flash(FlashJob const& job, std::function<void(qint64)> const& progress)
+        -> qint64;
+
+    FlashLimits _limits;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _idle;
+
+    int _nextId;
+    int _running;
+    std::vector<Job> _queue;    // by priority, then by id
+    QSet<QString> _busyDevices;
+    QHash<QString, GroupLimit> _hubs;
+    QHash<QString, GroupLimit> _controllers;
+
+    std::vector<FlashJobResult> _results;
+    std::vector<std::thread> _threads;
+};
+
+#endif // FLASHDISPATCHER_H
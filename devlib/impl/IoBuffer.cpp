@@ -0,0 +1,97 @@
+#include "IoBuffer.h"
+
+#include <atomic>
+
+namespace {
+    std::mutex Buffer_mutex;
+    devlib::BufferPolicy Buffer_policy;
+
+    // each fallback is reported once, buffers come in thousands
+    std::atomic<bool> Buffer_pagesWarned(false);
+    std::atomic<bool> Buffer_lockWarned(false);
+    std::atomic<bool> Buffer_mapWarned(false);
+
+
+    auto toNativePages(devlib::BufferPolicy::Pages pages) {
+        using Pages = devlib::native::memory::Pages;
+
+        switch (pages) {
+        case devlib::BufferPolicy::Pages::Huge:
+            return Pages::Huge;
+        case devlib::BufferPolicy::Pages::Transparent:
+            return Pages::Transparent;
+        case devlib::BufferPolicy::Pages::Normal:
+            break;
+        }
+
+        return Pages::Normal;
+    }
+
+
+    bool isDefault(devlib::BufferPolicy const& policy) {
+        return policy.pages == devlib::BufferPolicy::Pages::Normal
+            && !policy.prefault && !policy.lock;
+    }
+}
+
+
+void devlib::impl::IoBuffer::setPolicy(BufferPolicy const& policy)
+{
+    std::lock_guard<std::mutex> lock(Buffer_mutex);
+    Buffer_policy = policy;
+}
+
+
+auto devlib::impl::IoBuffer::policy(void)
+    -> BufferPolicy
+{
+    std::lock_guard<std::mutex> lock(Buffer_mutex);
+    return Buffer_policy;
+}
+
+
+devlib::impl::IoBuffer::IoBuffer(qint64 size, int numaNode)
+    : _size(alignUp(size)),
+      _data(nullptr)
+{
+    auto const current = policy();
+
+    if (!isDefault(current) && _size >= current.minimalSize) {
+        auto pages = toNativePages(current.pages);
+        _mapping = native::memory::map(_size, pages, numaNode,
+                                       current.prefault, current.lock);
+        _data = _mapping.data;
+
+        if (!_data) {
+            if (!Buffer_mapWarned.exchange(true)) {
+                qWarning() << "Can not map I/O buffers, using the heap";
+            }
+        } else {
+            if (_mapping.pages != pages && !Buffer_pagesWarned.exchange(true)) {
+                qWarning() << "Huge pages unavailable, I/O buffers use smaller ones";
+            }
+            if (current.lock && !_mapping.locked && !Buffer_lockWarned.exchange(true)) {
+                qWarning() << "Can not lock I/O buffers, check RLIMIT_MEMLOCK";
+            }
+        }
+    }
+
+    if (!_data) {
+        _data = static_cast<char*>(qMallocAligned(_size, Alignment));
+        Q_CHECK_PTR(_data);
+
+        if (numaNode >= 0) {
+            native::affinity::preferNode(_data, _size, numaNode);
+        }
+    }
+}
+
+
+devlib::impl::IoBuffer::~IoBuffer(void)
+{
+    if (_mapping.data) {
+        native::memory::unmap(_mapping);
+    } else {
+        qFreeAligned(_data);
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef IOBUFFER_H
+#define IOBUFFER_H
+
+#include "../BufferPolicy.h"
+#include "../native/native.h"
+
+#include <QtCore>
+
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace devlib {
+    namespace impl {
+        class IoBuffer;
+        class IoBufferPool;
+
+        // Reads until `size` bytes are in or the source runs dry
+        inline auto readFully(QIODevice& source, char* data, qint64 size) -> qint64 {
+            auto total = qint64(0);
+
+            while (total < size) {
+                auto count = source.read(data + total, size - total);
+                if (count <= 0) {
+                    break;
+                }
+                total += count;
+            }
+
+            return total;
+        }
+
+
+        // Writes all of `size` at `offset` without moving the file
+        // position, false on the first failure
+        inline bool writeAt(native::io::FileHandle* handle,
+                            char const* data, qint64 size, qint64 offset)
+        {
+            for (auto written = qint64(0); written < size; ) {
+                auto count = native::io::writeAt(handle, data + written,
+                                                 size - written, offset + written);
+                if (count <= 0) {
+                    return false;
+                }
+                written += count;
+            }
+
+            return true;
+        }
+
+
+        // xorshift64 stream: incompressible, so flash controllers can not
+        // shortcut writing it, and reproducible from `seed`
+        inline void fillPseudoRandom(char* data, qint64 size, quint64 seed) {
+            auto state = seed | 1;
+
+            for (auto offset = qint64(0); offset + 8 <= size; offset += 8) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                std::memcpy(data + offset, &state, sizeof(state));
+            }
+        }
+    }
+}
+
+
+// Block for unbuffered I/O: O_DIRECT and friends want both the
+// address and the length aligned to the logical sector, so the block
+// is page aligned and its size rounded up to whole pages. With
+// `numaNode` set its pages are placed on that node. Blocks from
+// BufferPolicy::minimalSize up follow the process wide policy,
+// smaller ones and everything the OS refuses come from the heap.
+class devlib::impl::IoBuffer
+{
+public:
+    static constexpr auto Alignment = qint64(4096);
+
+    static auto alignUp(qint64 size) -> qint64 {
+        return (size + Alignment - 1) / Alignment * Alignment;
+    }
+
+    static void setPolicy(BufferPolicy const& policy);
+    static auto policy(void) -> BufferPolicy;
+
+    explicit IoBuffer(qint64 size, int numaNode = -1);
+    ~IoBuffer(void);
+
+    IoBuffer(IoBuffer const&) = delete;
+    IoBuffer& operator=(IoBuffer const&) = delete;
+
+    IoBuffer(IoBuffer&& other) noexcept
+        : _size(other._size), _data(other._data), _mapping(other._mapping)
+    {
+        other._size = 0;
+        other._data = nullptr;
+        other._mapping = native::memory::Mapping();
+    }
+
+    auto data(void) const { return _data; }
+    auto size(void) const { return _size; }
+
+private:
+    qint64 _size;
+    char* _data;
+    native::memory::Mapping _mapping;   // empty for heap blocks
+};
+
+
+// Fixed set of equal IoBuffers handed out as shared_ptrs: a buffer goes
+// back to the pool when its last reference is dropped, and acquire()
+// blocks while every buffer is in use. The pool has to outlive them.
+class devlib::impl::IoBufferPool
+{
+public:
+    IoBufferPool(int count, qint64 size, int numaNode = -1) {
+        for (auto i = 0; i < count; i++) {
+            _free.push_back(std::make_unique<IoBuffer>(size, numaNode));
+        }
+    }
+
+    auto acquire(void) -> std::shared_ptr<IoBuffer> {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _released.wait(lock, [this] () { return !_free.empty(); });
+
+        auto buffer = _free.back().release();
+        _free.pop_back();
+
+        return std::shared_ptr<IoBuffer>(buffer, [this] (IoBuffer* released) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _free.emplace_back(released);
+            }
+            _released.notify_one();
+        });
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _released;
+    std::vector<std::unique_ptr<IoBuffer>> _free;
+};
+
+#endif // IOBUFFER_H
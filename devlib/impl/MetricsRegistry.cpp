@@ -0,0 +1,257 @@
+#include "MetricsRegistry.h"
+
+#include <cmath>
+
+namespace {
+    constexpr double Metrics_quantiles[] = { 0.5, 0.9, 0.99 };
+
+
+    auto escapeLabel(QString const& value) {
+        auto escaped = value.toUtf8();
+        escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+        return escaped;
+    }
+
+
+    void writeMetric(QByteArray& text, char const* name, char const* type,
+                     char const* help, qint64 value)
+    {
+        text += QByteArray("# HELP ") + name + ' ' + help + '\n';
+        text += QByteArray("# TYPE ") + name + ' ' + type + '\n';
+        text += QByteArray(name) + ' ' + QByteArray::number(value) + '\n';
+    }
+
+
+    void writeHeader(QByteArray& text, char const* name, char const* type, char const* help)
+    {
+        text += QByteArray("# HELP ") + name + ' ' + help + '\n';
+        text += QByteArray("# TYPE ") + name + ' ' + type + '\n';
+    }
+
+
+    auto httpResponse(QByteArray const& body) {
+        return QByteArray("HTTP/1.0 200 OK\r\n"
+                          "Content-Type: text/plain; version=0.0.4\r\n"
+                          "Content-Length: ") + QByteArray::number(body.size())
+            + "\r\n\r\n" + body;
+    }
+}
+
+
+auto devlib::impl::LatencyHistogram::bucketOf(qint64 microseconds)
+    -> int
+{
+    if (microseconds < 4) {
+        return int(qMax(microseconds, qint64(0)));
+    }
+
+    auto log = 63 - int(qCountLeadingZeroBits(quint64(microseconds)));
+    auto fraction = int((microseconds >> (log - 2)) & 3);
+
+    return qMin((log - 1) * 4 + fraction, BucketsCount - 1);
+}
+
+
+auto devlib::impl::LatencyHistogram::upperBound(int bucket)
+    -> qint64
+{
+    if (bucket < 4) {
+        return bucket + 1;
+    }
+
+    return qint64(5 + bucket % 4) << (bucket / 4 - 1);
+}
+
+
+auto devlib::impl::LatencyHistogram::percentiles(void) const
+    -> LatencyPercentiles
+{
+    auto counts = std::array<quint64, BucketsCount>();
+    auto total = quint64(0);
+
+    for (auto i = std::size_t(0); i < counts.size(); i++) {
+        counts[i] = _buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    float values[] = { 0, 0, 0 };
+    if (total > 0) {
+        for (auto q = 0; q < 3; q++) {
+            auto rank = quint64(std::ceil(Metrics_quantiles[q] * double(total)));
+            auto seen = quint64(0);
+            auto bucket = 0;
+
+            while (bucket < BucketsCount - 1 && seen + counts[std::size_t(bucket)] < rank) {
+                seen += counts[std::size_t(bucket)];
+                bucket++;
+            }
+            values[q] = float(upperBound(bucket)) / 1000;
+        }
+    }
+
+    return LatencyPercentiles{ values[0], values[1], values[2] };
+}
+
+
+auto devlib::impl::MetricsRegistry::instance(void)
+    -> MetricsRegistry&
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+
+auto devlib::impl::MetricsRegistry::device(QString const& devicePath)
+    -> DeviceCounters&
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto& counters = _devices[devicePath];
+    if (!counters) {
+        counters = std::make_unique<DeviceCounters>();
+    }
+
+    return *counters;
+}
+
+
+void devlib::impl::MetricsRegistry::sawDevices(std::vector<QString> const& devicePaths)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (auto const& path : devicePaths) {
+        if (_presentPaths.insert(path).second) {
+            _devicesSeen.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+
+void devlib::impl::MetricsRegistry::deviceAdded(QString const& devicePath)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // the list refreshed meanwhile may have counted it already
+    if (_presentPaths.insert(devicePath).second) {
+        _devicesSeen.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+void devlib::impl::MetricsRegistry::deviceRemoved(QString const& devicePath)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _presentPaths.erase(devicePath);
+}
+
+
+auto devlib::impl::MetricsRegistry::snapshot(void)
+    -> MetricsSnapshot
+{
+    auto snapshot = MetricsSnapshot{
+        _devicesSeen.load(), _flashesStarted.load(),
+        _flashesCompleted.load(), _flashesFailed.load(), 0, {}
+    };
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (auto const& entry : _devices) {
+        auto const& counters = *entry.second;
+        auto bytes = counters.bytesWritten.load(std::memory_order_relaxed);
+        auto seconds = double(counters.writeNanoseconds.load(std::memory_order_relaxed)) / 1e9;
+
+        snapshot.bytesWritten += bytes;
+        snapshot.devices.push_back({
+            entry.first, bytes, counters.writes.load(std::memory_order_relaxed), seconds,
+            seconds > 0 ? float(double(bytes) / 1e6 / seconds) : 0.0f,
+            counters.writeLatency.percentiles()
+        });
+    }
+
+    return snapshot;
+}
+
+
+auto devlib::impl::MetricsRegistry::prometheusText(void)
+    -> QByteArray
+{
+    auto const metrics = snapshot();
+    auto text = QByteArray();
+
+    writeMetric(text, "devlib_devices_seen_total", "counter",
+                "Storage devices seen, hotplug arrivals included", metrics.devicesSeen);
+    writeMetric(text, "devlib_flashes_started_total", "counter",
+                "Flash jobs and clone targets started", metrics.flashesStarted);
+    writeMetric(text, "devlib_flashes_completed_total", "counter",
+                "Flashes finished successfully", metrics.flashesCompleted);
+    writeMetric(text, "devlib_flashes_failed_total", "counter",
+                "Flashes failed or cancelled", metrics.flashesFailed);
+    writeMetric(text, "devlib_bytes_written_total", "counter",
+                "Bytes written to storage devices", metrics.bytesWritten);
+
+    if (metrics.devices.empty()) {
+        return text;
+    }
+
+    auto labels = std::vector<QByteArray>();
+    for (auto const& device : metrics.devices) {
+        labels.push_back("device=\"" + escapeLabel(device.devicePath) + '"');
+    }
+
+    writeHeader(text, "devlib_device_bytes_written_total", "counter",
+                "Bytes written to the device");
+    for (auto i = std::size_t(0); i < labels.size(); i++) {
+        text += "devlib_device_bytes_written_total{" + labels[i] + "} "
+              + QByteArray::number(metrics.devices[i].bytesWritten) + '\n';
+    }
+
+    writeHeader(text, "devlib_device_write_throughput_mbps", "gauge",
+                "Bytes written over the time spent in writes, MB/s");
+    for (auto i = std::size_t(0); i < labels.size(); i++) {
+        text += "devlib_device_write_throughput_mbps{" + labels[i] + "} "
+              + QByteArray::number(double(metrics.devices[i].writeMBps)) + '\n';
+    }
+
+    writeHeader(text, "devlib_device_write_latency_seconds", "summary",
+                "Latency of write calls to the device");
+    for (auto i = std::size_t(0); i < labels.size(); i++) {
+        auto const& device = metrics.devices[i];
+        auto const& latency = device.writeLatency;
+        float const valuesMs[] = { latency.p50Ms, latency.p90Ms, latency.p99Ms };
+
+        for (auto q = 0; q < 3; q++) {
+            text += "devlib_device_write_latency_seconds{" + labels[i]
+                  + ",quantile=\"" + QByteArray::number(Metrics_quantiles[q]) + "\"} "
+                  + QByteArray::number(double(valuesMs[q]) / 1000) + '\n';
+        }
+
+        text += "devlib_device_write_latency_seconds_sum{" + labels[i] + "} "
+              + QByteArray::number(device.writeSeconds) + '\n';
+        text += "devlib_device_write_latency_seconds_count{" + labels[i] + "} "
+              + QByteArray::number(device.writes) + '\n';
+    }
+
+    return text;
+}
+
+
+bool devlib::impl::MetricsRegistry::startExporter(QString const& socketPath)
+{
+    std::lock_guard<std::mutex> lock(_exporterMutex);
+
+    // the old one goes first, it may hold the same path
+    _exporter.reset();
+    _exporter = native::serveLocalSocket(socketPath, [this] (QByteArray const& request) {
+        auto body = prometheusText();
+        return request.startsWith("GET ") ? httpResponse(body) : body;
+    });
+
+    return _exporter != nullptr;
+}
+
+
+void devlib::impl::MetricsRegistry::stopExporter(void)
+{
+    std::lock_guard<std::mutex> lock(_exporterMutex);
+    _exporter.reset();
+}
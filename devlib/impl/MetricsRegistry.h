@@ -0,0 +1,105 @@
+#ifndef METRICSREGISTRY_H
+#define METRICSREGISTRY_H
+
+#include "../Metrics.h"
+#include "../native/native.h"
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+
+namespace devlib {
+    namespace impl {
+        class LatencyHistogram;
+        struct DeviceCounters;
+        class MetricsRegistry;
+    }
+}
+
+
+// Log-linear buckets of microseconds, four per power of two, so a
+// quantile is off by 25% at most. record() is one atomic increment.
+class devlib::impl::LatencyHistogram
+{
+public:
+    static constexpr auto BucketsCount = 128;
+
+    void record(qint64 microseconds) {
+        _buckets[std::size_t(bucketOf(microseconds))].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto percentiles(void) const -> LatencyPercentiles;
+
+private:
+    static auto bucketOf(qint64 microseconds) -> int;
+    static auto upperBound(int bucket) -> qint64;
+
+    std::array<std::atomic<quint64>, BucketsCount> _buckets{};
+};
+
+
+// Written by the I/O paths of one device path, lives as long as the process
+struct devlib::impl::DeviceCounters
+{
+    std::atomic<qint64> bytesWritten{0};
+    std::atomic<qint64> writes{0};
+    std::atomic<qint64> writeNanoseconds{0};    // spent inside write calls
+    LatencyHistogram writeLatency;
+
+    void written(qint64 bytes, qint64 nanoseconds) {
+        bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+        writes.fetch_add(1, std::memory_order_relaxed);
+        writeNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+        writeLatency.record(nanoseconds / 1000);
+    }
+};
+
+
+// Process wide counters behind devlib::Metrics. Looking a device up
+// takes a lock, so I/O paths do it once and keep the DeviceCounters;
+// everything they update afterwards is a relaxed atomic increment.
+class devlib::impl::MetricsRegistry
+{
+public:
+    static auto instance(void) -> MetricsRegistry&;
+
+    auto device(QString const& devicePath) -> DeviceCounters&;
+
+    // paths of a fresh device list and hotplug arrivals: each counts
+    // once until its "remove", whichever of the two reports it first
+    void sawDevices(std::vector<QString> const& devicePaths);
+    void deviceAdded(QString const& devicePath);
+    void deviceRemoved(QString const& devicePath);
+
+    void flashStarted(void) { _flashesStarted.fetch_add(1, std::memory_order_relaxed); }
+    void flashFinished(bool ok) {
+        (ok ? _flashesCompleted : _flashesFailed).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto snapshot(void) -> MetricsSnapshot;
+    auto prometheusText(void) -> QByteArray;
+
+    bool startExporter(QString const& socketPath);
+    void stopExporter(void);
+
+private:
+    MetricsRegistry(void) = default;
+
+    std::atomic<qint64> _devicesSeen{0};
+    std::atomic<qint64> _flashesStarted{0};
+    std::atomic<qint64> _flashesCompleted{0};
+    std::atomic<qint64> _flashesFailed{0};
+
+    std::mutex _mutex;
+    std::map<QString, std::unique_ptr<DeviceCounters>> _devices;
+    std::set<QString> _presentPaths;
+
+    // apart from _mutex: the exporter's thread takes that one
+    std::mutex _exporterMutex;
+    std::unique_ptr<native::LocalServer> _exporter;
+};
+
+#endif // METRICSREGISTRY_H
@@ -8,41 +8,34 @@ namespace devlib {
     namespace impl {
         class MountpointImpl;
         class MountpointLockImpl;
-        using MountpointLockFactory_t = std::function<
-            std::unique_ptr<IMountpointLock>(std::unique_ptr<native::LockHandle>)
-        >;
-
     }
 }
 
+// Nothing but the path, a QString copy shares its data
 class devlib::impl::MountpointImpl : public devlib::IMountpoint
 {
 public:
-    MountpointImpl(QString const& fsPath,
-                   impl::MountpointLockFactory_t locksFactory)
-        : _fsPath(fsPath), _locksFactory(locksFactory)
+    explicit MountpointImpl(QString const& fsPath)
+        : _fsPath(fsPath)
     { }
 
     virtual ~MountpointImpl(void) override = default;
 
 private:
     virtual bool isMounted_core(void) const override {
-        return !_fsPath.isEmpty();
+        return !_fsPath.isEmpty() && native::isMountpoint(_fsPath);
     }
 
     virtual auto fsPath_core(void) const
         -> QString const& override { return _fsPath; }
 
     virtual auto umount_core(void)
-        -> std::unique_ptr<devlib::IMountpointLock> override
-    { return _locksFactory(native::umountPartition(_fsPath)); }
+        -> std::unique_ptr<devlib::IMountpointLock> override;
 
     QString _fsPath;
-    impl::MountpointLockFactory_t _locksFactory;
 };
 
 
-
 class devlib::impl::MountpointLockImpl : public devlib::IMountpointLock
 {
 public:
@@ -65,4 +58,11 @@ private:
 };
 
 
+inline auto devlib::impl::MountpointImpl::umount_core(void)
+    -> std::unique_ptr<devlib::IMountpointLock>
+{
+    return std::make_unique<MountpointLockImpl>(native::umountPartition(_fsPath));
+}
+
+
 #endif // MOUNTPOINTIMPL_H
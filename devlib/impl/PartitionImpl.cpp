@@ -1,34 +1,47 @@
 #include "PartitionImpl.h"
+#include "MountpointImpl.h"
 #include "native/native.h"
 
-devlib::impl::PartitionImpl::PartitionImpl(const QString &filePath,
-                                           const QString &label,
-                                           MountpointFactory_t mntptFactory)
-    : _filePath(filePath),
-      _label(label),
-      _mntptFactory(mntptFactory)
+devlib::impl::PartitionImpl::PartitionImpl(std::shared_ptr<native::PartitionInfo const> info,
+                                           std::shared_ptr<DeviceRegistry> registry)
+    : _info(std::move(info)),
+      _registry(std::move(registry))
 { }
 
 
 auto devlib::impl::PartitionImpl::mount_core(const QString &path)
     -> std::unique_ptr<IMountpoint>
 {
-    return native::mount(_filePath, path) ?
-        _mntptFactory(path) : _mntptFactory("");
+    return std::make_unique<MountpointImpl>(
+        native::mount(_info->filePath, path, _info->fsType) ? path : QString()
+    );
+}
+
+
+auto devlib::impl::PartitionImpl::mountAsync_core(const QString &path)
+    -> std::future<std::unique_ptr<IMountpoint>>
+{
+    return std::async(std::launch::async,
+        [info = _info, path] () -> std::unique_ptr<IMountpoint> {
+            return std::make_unique<MountpointImpl>(
+                native::mount(info->filePath, path, info->fsType) ? path : QString()
+            );
+        }
+    );
 }
 
 
-auto devlib::impl::PartitionImpl::mountpoints_core(void)
-    ->std::vector<std::unique_ptr<IMountpoint>>
+auto devlib::impl::PartitionImpl::mountpoints_core(void) const
+    -> std::vector<std::unique_ptr<IMountpoint>>
 {
-    auto mntpts = native::mntptsForPartition(_filePath);
+    auto mntpts = _registry->mountpoints(_info->filePath);
     auto list = std::vector<
         std::unique_ptr<IMountpoint>
-    >(mntpts.size());
+    >(mntpts->size());
 
-    std::transform(mntpts.cbegin(), mntpts.cend(), list.begin(),
-        [this] (auto const& mntpt) {
-            return _mntptFactory(mntpt.first);
+    std::transform(mntpts->cbegin(), mntpts->cend(), list.begin(),
+        [] (auto const& mntpt) {
+            return std::make_unique<MountpointImpl>(mntpt.first);
         }
     );
 
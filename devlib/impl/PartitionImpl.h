@@ -3,42 +3,61 @@
 
 #include "../Partition.h"
 #include "../Mountpoint.h"
+#include "DeviceRegistry.h"
 
 namespace devlib {
     namespace impl {
         class PartitionImpl;
-        using MountpointFactory_t = std::function<
-            std::unique_ptr<IMountpoint>(QString const& name)
-        >;
     }
 }
 
 
+// Points into the registry's immutable partition list instead of
+// copying the entry; the list lives as long as any of its partitions.
 class devlib::impl::PartitionImpl : public devlib::IPartition
 {
 public:
-    PartitionImpl(QString const& filePath,
-                  QString const& label,
-                  impl::MountpointFactory_t mntptFactory);
+    PartitionImpl(std::shared_ptr<native::PartitionInfo const> info,
+                  std::shared_ptr<impl::DeviceRegistry> registry);
 
     virtual ~PartitionImpl(void) = default;
 
 private:
     virtual auto filePath_core(void) const noexcept
-        -> QString override { return _filePath; }
+        -> QString override { return _info->filePath; }
 
     virtual auto label_core(void) const noexcept
-        -> QString override { return _label; }
+        -> QString override { return _info->label; }
+
+    virtual auto fsType_core(void) const noexcept
+        -> QString override { return _info->fsType; }
+
+    virtual auto typeId_core(void) const noexcept
+        -> QString override { return _info->typeId; }
+
+    virtual auto uuid_core(void) const noexcept
+        -> QString override { return _info->uuid; }
+
+    virtual auto name_core(void) const noexcept
+        -> QString override { return _info->name; }
+
+    virtual auto start_core(void) const noexcept
+        -> qint64 override { return _info->start; }
+
+    virtual auto size_core(void) const noexcept
+        -> qint64 override { return _info->size; }
 
     virtual auto mount_core(const QString &path)
         -> std::unique_ptr<devlib::IMountpoint> override;
 
-    virtual auto mountpoints_core(void)
+    virtual auto mountAsync_core(const QString &path)
+        -> std::future<std::unique_ptr<devlib::IMountpoint>> override;
+
+    virtual auto mountpoints_core(void) const
         -> std::vector<std::unique_ptr<devlib::IMountpoint>> override;
 
-    QString _filePath;
-    QString _label;
-    impl::MountpointFactory_t _mntptFactory;
+    std::shared_ptr<native::PartitionInfo const> _info;
+    std::shared_ptr<impl::DeviceRegistry> _registry;
 };
 
 #endif // PARTITIONIMPL_H
@@ -0,0 +1,110 @@
+#include "Placement.h"
+#include "../native/native.h"
+
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace {
+    std::mutex Placement_mutex;
+    std::map<std::thread::id, devlib::WorkerPlacement> Placement_workers;
+
+
+    // Lives as long as the thread, drops its entry on exit
+    struct PlacementEntry {
+        bool listed = false;
+
+        ~PlacementEntry(void) {
+            if (listed) {
+                std::lock_guard<std::mutex> lock(Placement_mutex);
+                Placement_workers.erase(std::this_thread::get_id());
+            }
+        }
+    };
+
+    thread_local PlacementEntry Placement_entry;
+}
+
+
+auto devlib::impl::resolvePlacement(AffinityPolicy const& policy,
+                                    QString const& devicePath)
+    -> Placement
+{
+    auto placement = Placement();
+
+    switch (policy.mode) {
+    case AffinityPolicy::Mode::Inherit:
+        break;
+
+    case AffinityPolicy::Mode::DeviceLocal:
+        placement.node = native::affinity::deviceNode(devicePath);
+        placement.cpus = native::affinity::nodeCpus(placement.node);
+        break;
+
+    case AffinityPolicy::Mode::NumaNode:
+        placement.node = policy.numaNode;
+        placement.cpus = native::affinity::nodeCpus(placement.node);
+        break;
+
+    case AffinityPolicy::Mode::Cpus:
+        placement.cpus = policy.cpus;
+        if (!placement.cpus.empty()) {
+            placement.node = native::affinity::cpuNode(placement.cpus.front());
+        }
+        break;
+    }
+
+    // no CPUs for the node: buffers would be remote to the workers anyway
+    if (placement.cpus.empty()) {
+        placement.node = -1;
+    }
+
+    return placement;
+}
+
+
+void devlib::impl::placeCurrentThread(Placement const& placement,
+                                      QString const& role,
+                                      QString const& devicePath)
+{
+    if (!placement.cpus.empty()) {
+        native::affinity::pinCurrentThread(placement.cpus);
+    }
+
+    auto worker = WorkerPlacement();
+    worker.role = role;
+    worker.devicePath = devicePath;
+    worker.cpus = native::affinity::currentThreadCpus();
+    worker.cpu = native::affinity::currentCpu();
+    worker.numaNode = worker.cpu >= 0 ? native::affinity::cpuNode(worker.cpu) : -1;
+    worker.bufferNode = placement.node;
+
+    std::lock_guard<std::mutex> lock(Placement_mutex);
+    Placement_workers[std::this_thread::get_id()] = std::move(worker);
+    Placement_entry.listed = true;
+}
+
+
+auto devlib::impl::placementSetup(Placement const& placement,
+                                  QString const& role,
+                                  QString const& devicePath)
+    -> std::function<void(void)>
+{
+    return [placement, role, devicePath] () {
+        placeCurrentThread(placement, role, devicePath);
+    };
+}
+
+
+auto devlib::impl::workerPlacements(void)
+    -> std::vector<WorkerPlacement>
+{
+    std::lock_guard<std::mutex> lock(Placement_mutex);
+    auto workers = std::vector<WorkerPlacement>();
+
+    for (auto const& worker : Placement_workers) {
+        workers.push_back(worker.second);
+    }
+
+    return workers;
+}
@@ -0,0 +1,39 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include "../Affinity.h"
+
+#include <functional>
+
+namespace devlib {
+    namespace impl {
+        struct Placement;
+
+        // CPUs and node an AffinityPolicy comes down to for `devicePath`
+        auto resolvePlacement(AffinityPolicy const& policy, QString const& devicePath)
+            -> Placement;
+
+        // Pins the calling thread and lists it in workerPlacements()
+        // until the thread exits. Meant to run first on a new thread.
+        void placeCurrentThread(Placement const& placement,
+                                QString const& role,
+                                QString const& devicePath);
+
+        // WorkerPool thread setup doing placeCurrentThread()
+        auto placementSetup(Placement const& placement,
+                            QString const& role,
+                            QString const& devicePath)
+            -> std::function<void(void)>;
+
+        auto workerPlacements(void) -> std::vector<WorkerPlacement>;
+    }
+}
+
+
+struct devlib::impl::Placement
+{
+    std::vector<int> cpus;  // empty: leave the thread alone
+    int node = -1;          // for buffers, -1: first touch decides
+};
+
+#endif // PLACEMENT_H
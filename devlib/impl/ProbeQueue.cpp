@@ -0,0 +1,115 @@
+#include "ProbeQueue.h"
+
+#include <deque>
+#include <thread>
+
+#include <QtCore>
+
+
+struct devlib::impl::ProbeQueue::Job
+{
+    std::function<void(void)> task;
+    bool started = false;
+    bool finished = false;
+    bool abandoned = false;
+};
+
+
+struct devlib::impl::ProbeQueue::State
+{
+    std::mutex mutex;
+    std::deque<Handle> queued;
+    int running = 0;    // started, neither finished nor abandoned
+    int limit = 1;
+    bool stopped = false;
+};
+
+
+devlib::impl::ProbeQueue::ProbeQueue(int limit)
+    : _state(std::make_shared<State>())
+{
+    Q_ASSERT(limit > 0);
+    _state->limit = limit;
+}
+
+
+devlib::impl::ProbeQueue::~ProbeQueue(void)
+{
+    std::lock_guard<std::mutex> lock(_state->mutex);
+
+    // running threads keep the state alive until they return
+    _state->stopped = true;
+    _state->queued.clear();
+}
+
+
+auto devlib::impl::ProbeQueue::submit(std::function<void(void)> task)
+    -> Handle
+{
+    auto job = std::make_shared<Job>();
+    job->task = std::move(task);
+
+    std::unique_lock<std::mutex> lock(_state->mutex);
+    _state->queued.push_back(job);
+    pump(_state, lock);
+
+    return job;
+}
+
+
+bool devlib::impl::ProbeQueue::abandon(Handle const& handle)
+{
+    std::unique_lock<std::mutex> lock(_state->mutex);
+
+    if (!handle->started || handle->finished) {
+        return false;
+    }
+    if (handle->abandoned) {
+        return true;
+    }
+
+    handle->abandoned = true;
+    _state->running--;
+    pump(_state, lock);
+
+    return true;
+}
+
+
+void devlib::impl::ProbeQueue::setLimit(int limit)
+{
+    Q_ASSERT(limit > 0);
+
+    std::unique_lock<std::mutex> lock(_state->mutex);
+    _state->limit = limit;
+    pump(_state, lock);
+}
+
+
+void devlib::impl::ProbeQueue::pump(std::shared_ptr<State> const& state,
+                                    std::unique_lock<std::mutex>& lock)
+{
+    Q_ASSERT(lock.owns_lock());
+
+    while (!state->stopped && !state->queued.empty()
+           && state->running < state->limit) {
+        auto job = state->queued.front();
+        state->queued.pop_front();
+
+        job->started = true;
+        state->running++;
+
+        std::thread([state, job] () {
+            job->task();
+
+            std::unique_lock<std::mutex> lock(state->mutex);
+            job->finished = true;
+            job->task = nullptr;
+
+            if (!job->abandoned) {
+                state->running--;
+            }
+            pump(state, lock);
+        }).detach();
+    }
+}
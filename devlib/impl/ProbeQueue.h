@@ -0,0 +1,49 @@
+#ifndef PROBEQUEUE_H
+#define PROBEQUEUE_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace devlib {
+    namespace impl {
+        class ProbeQueue;
+    }
+}
+
+
+// Runs blocking device probes on their own detached threads, at most
+// `limit` at once, in FIFO order. Unlike WorkerPool it never joins:
+// a probe stuck on a hung device can be abandoned, it then stops
+// counting toward the limit and its thread is left to finish (or hang)
+// on its own. The destructor drops queued probes and returns at once.
+class devlib::impl::ProbeQueue
+{
+    struct Job;
+    struct State;
+
+public:
+    using Handle = std::shared_ptr<Job>;
+
+    explicit ProbeQueue(int limit);
+    ~ProbeQueue(void);
+
+    ProbeQueue(ProbeQueue const&) = delete;
+    ProbeQueue& operator=(ProbeQueue const&) = delete;
+
+    auto submit(std::function<void(void)> task) -> Handle;
+
+    // a running probe frees its slot, a queued one keeps its place;
+    // true if the probe was running
+    bool abandon(Handle const& handle);
+
+    void setLimit(int limit);
+
+private:
+    static void pump(std::shared_ptr<State> const& state,
+                     std::unique_lock<std::mutex>& lock);
+
+    std::shared_ptr<State> _state;
+};
+
+#endif // PROBEQUEUE_H
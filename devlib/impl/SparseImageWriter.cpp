@@ -0,0 +1,237 @@
+#include "SparseImageWriter.h"
+#include "../native/crc32.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr auto Sparse_bufferSize = qint64(4) * 1024 * 1024;
+
+    constexpr auto Sparse_fileHeaderSize = 28;
+    constexpr auto Sparse_chunkHeaderSize = 12;
+
+    enum ChunkType : quint16 {
+        Chunk_raw = 0xCAC1,
+        Chunk_fill = 0xCAC2,
+        Chunk_dontCare = 0xCAC3,
+        Chunk_crc32 = 0xCAC4
+    };
+
+    auto le16(uchar const* data) { return qFromLittleEndian<quint16>(data); }
+    auto le32(uchar const* data) { return qFromLittleEndian<quint32>(data); }
+
+
+    // Consumes `size` bytes of the header which this version does not know
+    bool skipSource(QIODevice& source, qint64 size) {
+        char scratch[64];
+
+        while (size > 0) {
+            auto count = source.read(scratch, std::min<qint64>(size, sizeof(scratch)));
+            if (count <= 0) {
+                return false;
+            }
+            size -= count;
+        }
+
+        return true;
+    }
+}
+
+
+devlib::impl::SparseImageWriter::SparseImageWriter(native::io::FileHandle* device)
+    : _device(device),
+      _buffer(Sparse_bufferSize),
+      _position(0),
+      _bytesWritten(0),
+      _seekPending(true),
+      _crc(0)
+{
+    Q_ASSERT(device);
+}
+
+
+auto devlib::impl::SparseImageWriter::write(QIODevice& source)
+    -> qint64
+{
+    uchar header[Sparse_fileHeaderSize];
+    if (readFully(source, reinterpret_cast<char*>(header), Sparse_fileHeaderSize)
+                != Sparse_fileHeaderSize
+            || le32(header) != Magic) {
+        qWarning() << "Not an Android sparse image";
+        return -1;
+    }
+
+    auto majorVersion = le16(header + 4);
+    auto fileHeaderSize = le16(header + 8);
+    auto chunkHeaderSize = le16(header + 10);
+    auto blockSize = qint64(le32(header + 12));
+    auto totalBlocks = qint64(le32(header + 16));
+    auto totalChunks = le32(header + 20);
+    auto imageChecksum = le32(header + 24);
+
+    if (majorVersion != 1
+            || fileHeaderSize < Sparse_fileHeaderSize
+            || chunkHeaderSize < Sparse_chunkHeaderSize
+            || blockSize == 0 || blockSize % 4 != 0) {
+        qWarning() << "Unsupported sparse image header";
+        return -1;
+    }
+
+    if (!skipSource(source, fileHeaderSize - Sparse_fileHeaderSize)) {
+        return -1;
+    }
+
+    for (auto i = 0u; i < totalChunks; i++) {
+        uchar chunk[Sparse_chunkHeaderSize];
+        if (readFully(source, reinterpret_cast<char*>(chunk), Sparse_chunkHeaderSize)
+                != Sparse_chunkHeaderSize
+                || !skipSource(source, chunkHeaderSize - Sparse_chunkHeaderSize)) {
+            qWarning() << "Sparse image is truncated at chunk" << i;
+            return -1;
+        }
+
+        auto type = le16(chunk);
+        auto size = qint64(le32(chunk + 4)) * blockSize;
+        auto payloadSize = qint64(le32(chunk + 8)) - chunkHeaderSize;
+
+        auto value = quint32(0);
+        auto readValue = [&source, &value] () {
+            uchar data[4];
+            auto ok = readFully(source, reinterpret_cast<char*>(data), 4) == 4;
+            value = le32(data);
+            return ok;
+        };
+
+        auto ok = false;
+        switch (type) {
+        case Chunk_raw:
+            ok = payloadSize == size && writeRaw(source, size);
+            break;
+        case Chunk_fill:
+            ok = payloadSize == 4 && readValue() && writeFill(value, size);
+            break;
+        case Chunk_dontCare:
+            ok = payloadSize == 0;
+            skip(size);
+            break;
+        case Chunk_crc32:
+            ok = payloadSize == 4 && readValue();
+            if (ok && value != _crc) {
+                qWarning() << "Sparse image CRC mismatch at" << _position;
+                return -1;
+            }
+            break;
+        default:
+            qWarning() << "Unknown sparse chunk type" << QString::number(type, 16);
+            break;
+        }
+
+        if (!ok) {
+            qWarning() << "Can not process sparse chunk" << i << "at" << _position;
+            return -1;
+        }
+    }
+
+    if (_position != totalBlocks * blockSize) {
+        qWarning() << "Sparse image chunks do not cover its"
+                   << totalBlocks << "blocks";
+        return -1;
+    }
+
+    if (imageChecksum != 0 && imageChecksum != _crc) {
+        qWarning() << "Sparse image checksum mismatch";
+        return -1;
+    }
+
+    return _position;
+}
+
+
+bool devlib::impl::SparseImageWriter::writeRaw(QIODevice& source, qint64 size)
+{
+    while (size > 0) {
+        auto count = std::min(size, _buffer.size());
+        if (readFully(source, _buffer.data(), count) != count) {
+            return false;
+        }
+
+        _crc = native::crc32(_buffer.data(), count, _crc);
+        if (!writeBuffer(count)) {
+            return false;
+        }
+        size -= count;
+    }
+
+    return true;
+}
+
+
+bool devlib::impl::SparseImageWriter::writeFill(quint32 pattern, qint64 size)
+{
+    if (pattern == 0 && native::io::zeroRange(_device, _position, size)) {
+        skip(size);
+        return true;
+    }
+
+    auto filled = std::min(size, _buffer.size());
+    for (auto offset = qint64(0); offset < filled; offset += 4) {
+        qToLittleEndian(pattern, _buffer.data() + offset);
+    }
+
+    while (size > 0) {
+        auto count = std::min(size, filled);
+        _crc = pattern == 0 ? native::crc32Zeros(count, _crc)
+                            : native::crc32(_buffer.data(), count, _crc);
+        if (!writeBuffer(count)) {
+            return false;
+        }
+        size -= count;
+    }
+
+    return true;
+}
+
+
+// Counts as zeroes for the CRC: DONT_CARE data is checksummed
+// that way, and zeroed FILL ranges really are zeroes
+void devlib::impl::SparseImageWriter::skip(qint64 size)
+{
+    _crc = native::crc32Zeros(size, _crc);
+    _position += size;
+    _seekPending = true;
+}
+
+
+bool devlib::impl::SparseImageWriter::writeBuffer(qint64 size)
+{
+    if (!seekIfNeeded()) {
+        return false;
+    }
+
+    for (auto written = qint64(0); written < size; ) {
+        auto count = native::io::write(_device, _buffer.data() + written, size - written);
+        if (count <= 0) {
+            qWarning() << "Can not write sparse image data at" << _position;
+            return false;
+        }
+
+        written += count;
+        _position += count;
+        _bytesWritten += count;
+    }
+
+    return true;
+}
+
+
+bool devlib::impl::SparseImageWriter::seekIfNeeded(void)
+{
+    if (_seekPending) {
+        if (!native::io::seek(_device, _position)) {
+            qWarning() << "Can not seek to" << _position;
+            return false;
+        }
+        _seekPending = false;
+    }
+
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef SPARSEIMAGEWRITER_H
+#define SPARSEIMAGEWRITER_H
+
+#include "../native/native.h"
+#include "IoBuffer.h"
+
+namespace devlib {
+    namespace impl {
+        class SparseImageWriter;
+    }
+}
+
+
+// Streams an Android sparse image to the device chunk by chunk:
+// RAW chunks are copied through one buffer, FILL chunks become zero-out
+// requests or pattern writes, DONT_CARE ranges are seeked over and
+// CRC32 chunks are checked against the data expanded so far.
+class devlib::impl::SparseImageWriter
+{
+public:
+    static constexpr auto Magic = quint32(0xED26FF3A);
+
+    explicit SparseImageWriter(native::io::FileHandle* device);
+
+    // Expanded image size, -1 if the image is malformed or the device
+    // failed. The source is read sequentially, it is never seeked.
+    auto write(QIODevice& source) -> qint64;
+
+    // bytes actually sent to the device so far; DONT_CARE ranges and
+    // fills done by zeroing the range are not
+    auto bytesWritten(void) const -> qint64 { return _bytesWritten; }
+
+private:
+    bool writeRaw(QIODevice& source, qint64 size);
+    bool writeFill(quint32 pattern, qint64 size);
+    void skip(qint64 size);
+
+    bool writeBuffer(qint64 size);
+    bool seekIfNeeded(void);
+
+    native::io::FileHandle* _device;
+    IoBuffer _buffer;
+    qint64 _position;
+    qint64 _bytesWritten;
+    bool _seekPending;
+    quint32 _crc;
+};
+
+#endif // SPARSEIMAGEWRITER_H
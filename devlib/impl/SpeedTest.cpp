@@ -0,0 +1,223 @@
+#include "SpeedTest.h"
+#include "IoBuffer.h"
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <vector>
+#include <set>
+
+namespace {
+    constexpr auto Speed_sequentialRequest = qint64(1024) * 1024;
+    constexpr auto Speed_randomRequest = qint64(4096);
+    constexpr auto Speed_minScratchSize = qint64(1024) * 1024;
+    constexpr auto Speed_patternSeed = quint64(0xD1B54A32D192ED03ull);
+
+    using Clock = std::chrono::steady_clock;
+
+
+    auto milliseconds(Clock::duration time) -> float {
+        return float(std::chrono::duration<double, std::milli>(time).count());
+    }
+
+
+    auto megabytesPerSecond(qint64 bytes, Clock::duration time) -> float {
+        auto seconds = std::chrono::duration<double>(time).count();
+        return seconds > 0 ? float(bytes / 1e6 / seconds) : 0.0f;
+    }
+
+
+    auto percentiles(std::vector<float> samples) -> devlib::LatencyPercentiles {
+        if (samples.empty()) {
+            return { 0, 0, 0 };
+        }
+
+        auto at = [&samples] (double rank) {
+            auto index = std::size_t(rank * (samples.size() - 1));
+            std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+            return samples[index];
+        };
+
+        return { at(0.50), at(0.90), at(0.99) };
+    }
+
+
+    auto gradeOf(devlib::SpeedClass const& result) {
+        using devlib::SpeedGrade;
+
+        if (result.sequentialWriteMBps < 10 || result.randomWriteIops < 100) {
+            return SpeedGrade::Slow;
+        }
+        if (result.sequentialWriteMBps >= 30 && result.randomWriteIops >= 500) {
+            return SpeedGrade::Fast;
+        }
+        return SpeedGrade::Medium;
+    }
+
+
+    std::mutex Speed_cacheMutex;
+    QHash<QString, devlib::SpeedClass> Speed_cache;
+}
+
+
+devlib::impl::SpeedTest::SpeedTest(native::io::FileHandle* reader,
+                                   native::io::FileHandle* writer)
+    : _reader(reader),
+      _writer(writer)
+{
+    Q_ASSERT(reader);
+    Q_ASSERT(writer);
+}
+
+
+auto devlib::impl::SpeedTest::run(qint64 capacity, SpeedTestOptions const& options)
+    -> SpeedClass
+{
+    auto result = SpeedClass{ 0, 0, 0, 0, { 0, 0, 0 }, { 0, 0, 0 },
+                              SpeedGrade::Unknown, false };
+
+    auto offset = options.scratchOffset >= 0 ?
+        options.scratchOffset / Speed_sequentialRequest * Speed_sequentialRequest :
+        capacity / 2 / Speed_sequentialRequest * Speed_sequentialRequest;
+    auto size = std::min(options.scratchSize, capacity - offset)
+        / Speed_randomRequest * Speed_randomRequest;
+
+    if (size < Speed_minScratchSize) {
+        qWarning() << "No room for a speed test scratch region";
+        return result;
+    }
+
+    IoBuffer chunk(Speed_sequentialRequest);
+    auto saved = std::unique_ptr<IoBuffer>();
+    auto budget = options.phaseDuration;
+
+    // sequential read, doubles as the backup of the region
+    {
+        if (options.preserveContents) {
+            saved = std::make_unique<IoBuffer>(size);
+        }
+
+        auto read = qint64(0);
+        auto begin = Clock::now();
+
+        while (read < size && (saved || Clock::now() - begin < budget)) {
+            auto count = std::min(Speed_sequentialRequest, size - read);
+            auto data = saved ? saved->data() + read : chunk.data();
+
+            if (native::io::readAt(_reader, data, count, offset + read) != count) {
+                qWarning() << "Speed test read failed at" << offset + read;
+                return result;
+            }
+            read += count;
+        }
+        result.sequentialReadMBps = megabytesPerSecond(read, Clock::now() - begin);
+    }
+
+    // everything below is undone from `saved` at the end
+    auto writtenExtent = qint64(0);
+    auto randomlyWritten = std::set<qint64>();
+    auto failed = false;
+
+    fillPseudoRandom(chunk.data(), chunk.size(), Speed_patternSeed);
+    {
+        auto begin = Clock::now();
+
+        while (writtenExtent < size && Clock::now() - begin < budget) {
+            auto count = std::min(Speed_sequentialRequest, size - writtenExtent);
+            if (!writeAt(_writer, chunk.data(), count, offset + writtenExtent)) {
+                failed = true;
+                break;
+            }
+            writtenExtent += count;
+        }
+        result.sequentialWriteMBps =
+            megabytesPerSecond(writtenExtent, Clock::now() - begin);
+    }
+
+    auto random = std::mt19937_64(std::random_device()());
+    auto blocks = std::uniform_int_distribution<qint64>(0, size / Speed_randomRequest - 1);
+
+    auto randomPhase = [&] (bool writing) {
+        auto latencies = std::vector<float>();
+        auto begin = Clock::now();
+
+        while (!failed && Clock::now() - begin < budget) {
+            auto position = offset + blocks(random) * Speed_randomRequest;
+            auto requestBegin = Clock::now();
+
+            if (writing) {
+                failed = !writeAt(_writer, chunk.data(), Speed_randomRequest, position);
+                randomlyWritten.insert(position);
+            } else {
+                failed = native::io::readAt(_reader, chunk.data(), Speed_randomRequest,
+                                            position) != Speed_randomRequest;
+            }
+            latencies.push_back(milliseconds(Clock::now() - requestBegin));
+        }
+
+        auto seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        auto iops = seconds > 0 ? float(latencies.size() / seconds) : 0.0f;
+
+        return std::make_pair(iops, percentiles(std::move(latencies)));
+    };
+
+    if (!failed) {
+        auto writes = randomPhase(true);
+        result.randomWriteIops = writes.first;
+        result.writeLatency = writes.second;
+    }
+    if (!failed) {
+        auto reads = randomPhase(false);
+        result.randomReadIops = reads.first;
+        result.readLatency = reads.second;
+    }
+
+    if (saved) {
+        auto restored = writeAt(_writer, saved->data(), writtenExtent, offset);
+        for (auto position : randomlyWritten) {
+            if (position >= offset + writtenExtent) {
+                restored = writeAt(_writer, saved->data() + (position - offset),
+                                   Speed_randomRequest, position) && restored;
+            }
+        }
+
+        if (!restored) {
+            qWarning() << "Speed test could not restore its scratch region";
+            failed = true;
+        }
+    }
+
+    if (failed) {
+        qWarning() << "Speed test failed inside" << offset << "+" << size;
+        return result;
+    }
+
+    result.grade = gradeOf(result);
+    return result;
+}
+
+
+bool devlib::impl::SpeedTest::cached(QString const& serial, SpeedClass* result)
+{
+    std::lock_guard<std::mutex> lock(Speed_cacheMutex);
+
+    auto found = Speed_cache.constFind(serial);
+    if (serial.isEmpty() || found == Speed_cache.cend()) {
+        return false;
+    }
+
+    *result = found.value();
+    result->cached = true;
+    return true;
+}
+
+
+void devlib::impl::SpeedTest::remember(QString const& serial, SpeedClass const& result)
+{
+    if (serial.isEmpty() || result.grade == SpeedGrade::Unknown) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(Speed_cacheMutex);
+    Speed_cache.insert(serial, result);
+}
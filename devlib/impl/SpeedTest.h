@@ -0,0 +1,34 @@
+#ifndef SPEEDTEST_H
+#define SPEEDTEST_H
+
+#include "../SpeedClass.h"
+#include "../native/native.h"
+
+namespace devlib {
+    namespace impl {
+        class SpeedTest;
+    }
+}
+
+
+// Short benchmark inside a scratch region of an opened device:
+// sequential read and write in 1 MiB requests, then random 4 KiB writes
+// and reads, each phase bounded by time. Results are kept per device
+// serial for the lifetime of the process.
+class devlib::impl::SpeedTest
+{
+public:
+    SpeedTest(native::io::FileHandle* reader, native::io::FileHandle* writer);
+
+    // grade is Unknown if the device failed or is too small
+    auto run(qint64 capacity, SpeedTestOptions const& options) -> SpeedClass;
+
+    static bool cached(QString const& serial, SpeedClass* result);
+    static void remember(QString const& serial, SpeedClass const& result);
+
+private:
+    native::io::FileHandle* _reader;
+    native::io::FileHandle* _writer;
+};
+
+#endif // SPEEDTEST_H
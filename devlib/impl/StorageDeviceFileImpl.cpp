@@ -1,19 +1,87 @@
 #include "StorageDeviceFileImpl.h"
+#include "CapacityProbe.h"
+#include "DeviceBackup.h"
+#include "DeviceScanner.h"
+#include "IoBuffer.h"
+#include "Placement.h"
+#include "SparseImageWriter.h"
+#include "SpeedTest.h"
+#include "WorkerPool.h"
+#include "../native/trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+namespace {
+    constexpr auto Umount_defaultDeadline = std::chrono::milliseconds(3000);
+
+    // chunks being read or compared at once, one worker each
+    constexpr auto Verify_inFlight = 4;
+    constexpr auto Verify_chunkSize = qint64(4) * 1024 * 1024;
+
+    // verifyChunk() results besides a mismatch offset
+    constexpr auto Verify_matches = qint64(-1);
+    constexpr auto Verify_readFailed = qint64(-2);
+
+
+    // Reads [offset, offset + length) of the device into `deviceData` and
+    // compares it with `sourceData`. Returns offset of the first differing
+    // byte, Verify_matches, or Verify_readFailed if the device could not
+    // be read in full: an I/O error is not a data mismatch.
+    auto verifyChunk(devlib::native::io::FileHandle* device,
+                     char* deviceData, char const* sourceData,
+                     qint64 offset, qint64 length) -> qint64
+    {
+        using devlib::impl::IoBuffer;
+        devlib::native::trace::Span span("file", "verifyChunk");
+
+        auto read = devlib::native::io::readAt(
+            device, deviceData, IoBuffer::alignUp(length), offset
+        );
+        if (read < length) {
+            return Verify_readFailed;
+        }
+
+        if (std::memcmp(sourceData, deviceData, std::size_t(length)) == 0) {
+            return Verify_matches;
+        }
+
+        auto difference = std::mismatch(sourceData, sourceData + length, deviceData);
+        return offset + (difference.first - sourceData);
+    }
+}
 
 
 devlib::impl::StorageDeviceFileImpl::
     StorageDeviceFileImpl(QString const& deviceFilename,
                           std::shared_ptr<IStorageDeviceInfo> storageDeviceInfo)
     : _deviceFilename(deviceFilename),
-      _deviceInfo(std::move(storageDeviceInfo))
+      _deviceInfo(std::move(storageDeviceInfo)),
+      _umountPolicy{ Umount_defaultDeadline, false },
+      _metrics(MetricsRegistry::instance().device(deviceFilename))
 { }
 
 
 bool devlib::impl::StorageDeviceFileImpl::open_core(OpenMode mode, bool withAuthorization)
 {
     Q_UNUSED(mode);
+    native::trace::Span span("file", "open", _deviceFilename);
+
     // first: unmount disk
-    if (!devlib::native::umountDisk(_deviceInfo->filePath())) {
+    auto report = devlib::native::umountDisk(_deviceInfo->filePath(),
+                                             _umountPolicy.deadline,
+                                             _umountPolicy.lazyDetach);
+    _busyMntpts.clear();
+
+    if (report.status == native::UmountStatus::Busy) {
+        for (auto const& mntpt : report.busyMountpoints) {
+            _busyMntpts.append(mntpt);
+        }
+        return false;
+    }
+
+    if (report.status == native::UmountStatus::NotHandled) {
         auto mntpts = _deviceInfo->mountpoints();
         _mntptsLocks.clear();
         for (auto const & mntpt : mntpts) {
@@ -21,6 +89,7 @@ bool devlib::impl::StorageDeviceFileImpl::open_core(OpenMode mode, bool withAuth
             if (mntptLock->locked()){
                 _mntptsLocks.push_back(std::move(mntptLock));
             } else {
+                _busyMntpts.append(mntpt->fsPath());
                 return false;
             }
         }
@@ -40,6 +109,7 @@ bool devlib::impl::StorageDeviceFileImpl::open_core(OpenMode mode, bool withAuth
 
 void devlib::impl::StorageDeviceFileImpl::close_core(void)
 {
+    native::trace::Span span("file", "close", _deviceFilename);
     QFile::setOpenMode(QIODevice::NotOpen);
     _fileHandle.reset();
     _mntptsLocks.clear();
@@ -49,6 +119,7 @@ void devlib::impl::StorageDeviceFileImpl::close_core(void)
 auto devlib::impl::StorageDeviceFileImpl::
     readData_core(char* data, qint64 len) -> qint64
 {
+    native::trace::Span span("file", "read");
     return native::io::read(_fileHandle.get(), data, len);
 }
 
@@ -56,7 +127,16 @@ auto devlib::impl::StorageDeviceFileImpl::
 auto devlib::impl::StorageDeviceFileImpl::
     writeData_core(const char *data, qint64 len) -> qint64
 {
-    return native::io::write(_fileHandle.get(), data, len);
+    native::trace::Span span("file", "write");
+
+    auto begin = std::chrono::steady_clock::now();
+    auto written = native::io::write(_fileHandle.get(), data, len);
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+
+    if (written > 0) {
+        _metrics.written(written, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+    return written;
 }
 
 
@@ -66,7 +146,210 @@ bool devlib::impl::StorageDeviceFileImpl::seek_core(qint64 pos)
 }
 
 
-void devlib::impl::StorageDeviceFileImpl::sync_core(void)
+bool devlib::impl::StorageDeviceFileImpl::sync_core(void)
+{
+    native::trace::Span span("file", "sync", _deviceFilename);
+    return devlib::native::io::sync(_fileHandle.get());
+}
+
+
+auto devlib::impl::StorageDeviceFileImpl::
+    verify_core(QIODevice& source, qint64 length) -> VerifyResult
+{
+    native::trace::Span span("file", "verify", _deviceFilename);
+    auto result = VerifyResult{ 0, -1, false };
+
+    if (isOpen() && isWritable()) {
+        sync_core();
+    }
+
+    auto device = native::io::openDirect(_deviceFilename.toStdString().data());
+    if (!device) {
+        return result;
+    }
+
+    if (length < 0) {
+        length = source.size() - source.pos();
+    }
+
+    struct Pending {
+        qint64 length;
+        std::future<qint64> mismatch;
+    };
+
+    // buffers of slot i are reused by every Verify_inFlight-th chunk,
+    // its previous chunk is always the oldest pending one
+    // both sides are compared by the workers, so both live on their node
+    auto placement = resolvePlacement(_affinity, _deviceFilename);
+    auto deviceBuffers = std::vector<IoBuffer>();
+    auto sourceBuffers = std::vector<IoBuffer>();
+    for (auto i = 0; i < Verify_inFlight; i++) {
+        deviceBuffers.emplace_back(Verify_chunkSize, placement.node);
+        sourceBuffers.emplace_back(Verify_chunkSize, placement.node);
+    }
+
+    auto pending = std::deque<Pending>();
+    auto deviceFailed = false;
+    auto finishOldest = [&pending, &result, &deviceFailed] () {
+        auto chunk = std::move(pending.front());
+        pending.pop_front();
+
+        auto mismatch = chunk.mismatch.get();
+        if (result.firstMismatch != -1 || deviceFailed) {
+            return;
+        }
+
+        if (mismatch == Verify_readFailed) {
+            deviceFailed = true;
+        } else if (mismatch == Verify_matches) {
+            result.verified += chunk.length;
+        } else {
+            result.firstMismatch = mismatch;
+            result.verified = mismatch;
+        }
+    };
+
+    auto offset = qint64(0);
+    auto slot = std::size_t(0);
+    auto sourceComplete = true;
+
+    {
+        WorkerPool workers(Verify_inFlight,
+                           placementSetup(placement, "verify", _deviceFilename));
+
+        while (offset < length && result.firstMismatch == -1 && !deviceFailed) {
+            if (pending.size() == std::size_t(Verify_inFlight)) {
+                finishOldest();
+                continue;
+            }
+
+            auto chunkLength = std::min(Verify_chunkSize, length - offset);
+            auto deviceData = deviceBuffers[slot].data();
+            auto sourceData = sourceBuffers[slot].data();
+
+            if (readFully(source, sourceData, chunkLength) != chunkLength) {
+                sourceComplete = false;
+                break;
+            }
+
+            auto handle = device.get();
+            pending.push_back({ chunkLength, workers.submit(
+                [handle, deviceData, sourceData, offset, chunkLength] () {
+                    return verifyChunk(handle, deviceData, sourceData,
+                                       offset, chunkLength);
+                })
+            });
+
+            offset += chunkLength;
+            slot = (slot + 1) % Verify_inFlight;
+        }
+
+        while (!pending.empty()) {
+            finishOldest();
+        }
+    }
+
+    if (deviceFailed) {
+        qWarning() << "Can not read" << _deviceFilename << "back at" << result.verified;
+    }
+
+    result.completed = sourceComplete && !deviceFailed
+            && (result.firstMismatch != -1 || result.verified == length);
+
+    return result;
+}
+
+
+auto devlib::impl::StorageDeviceFileImpl::
+    writeSparseImage_core(QIODevice& source) -> qint64
+{
+    native::trace::Span span("file", "writeSparseImage", _deviceFilename);
+
+    // expanded in one go, so the bytes count but there is no per-write
+    // latency; skipped and zeroed ranges were never sent to the device
+    SparseImageWriter writer(_fileHandle.get());
+    auto written = writer.write(source);
+    _metrics.bytesWritten.fetch_add(writer.bytesWritten(), std::memory_order_relaxed);
+
+    return written;
+}
+
+
+auto devlib::impl::StorageDeviceFileImpl::
+    backup_core(QString const& imagePath, BackupOptions const& options) -> BackupResult
 {
-    devlib::native::io::sync(_fileHandle.get());
+    native::trace::Span span("file", "backup", _deviceFilename);
+
+    // open() unmounted the device, a mounted one may change while read
+    if (!isOpen()) {
+        qWarning() << "Can not back up" << _deviceFilename << ", it is not open";
+        return BackupResult{ 0, 0, false };
+    }
+
+    auto length = options.length > 0 ? options.length : _deviceInfo->capacity();
+    if (length <= 0) {
+        qWarning() << "Can not back up" << _deviceFilename << ", its size is unknown";
+        return BackupResult{ 0, 0, false };
+    }
+
+    auto placement = resolvePlacement(_affinity, _deviceFilename);
+
+    return DeviceBackup(_deviceFilename, options, placement).run(imagePath, length);
+}
+
+
+auto devlib::impl::StorageDeviceFileImpl::
+    scan_core(ScanOptions const& options) -> HeatMap
+{
+    native::trace::Span span("file", "scan", _deviceFilename);
+    auto reader = native::io::openDirect(_deviceFilename.toStdString().data());
+    if (!reader) {
+        return HeatMap{ options.regionSize, {}, false };
+    }
+
+    auto writer = options.mode == ScanMode::Read ? nullptr : _fileHandle.get();
+    auto length = options.length > 0 ? options.length : _deviceInfo->capacity();
+
+    return DeviceScanner(reader.get(), writer).run(options, length);
+}
+
+
+auto devlib::impl::StorageDeviceFileImpl::
+    probeCapacity_core(int samples, bool preserveContents) -> CapacityProbeResult
+{
+    native::trace::Span span("file", "probeCapacity", _deviceFilename);
+    auto capacity = _deviceInfo->capacity();
+    auto reader = native::io::openDirect(_deviceFilename.toStdString().data());
+
+    if (!reader || capacity <= 0) {
+        return CapacityProbeResult{ capacity, 0, -1, 0, false };
+    }
+
+    return CapacityProbe(reader.get(), _fileHandle.get())
+        .run(capacity, samples, preserveContents);
+}
+
+
+auto devlib::impl::StorageDeviceFileImpl::
+    classifySpeed_core(SpeedTestOptions const& options) -> SpeedClass
+{
+    native::trace::Span span("file", "classifySpeed", _deviceFilename);
+    auto serial = _deviceInfo->serial();
+    auto result = SpeedClass{ 0, 0, 0, 0, { 0, 0, 0 }, { 0, 0, 0 },
+                              SpeedGrade::Unknown, false };
+
+    if (options.useCache && SpeedTest::cached(serial, &result)) {
+        return result;
+    }
+
+    auto reader = native::io::openDirect(_deviceFilename.toStdString().data());
+    if (!reader) {
+        return result;
+    }
+
+    result = SpeedTest(reader.get(), _fileHandle.get())
+        .run(_deviceInfo->capacity(), options);
+    SpeedTest::remember(serial, result);
+
+    return result;
 }
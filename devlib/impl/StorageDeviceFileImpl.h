@@ -4,6 +4,7 @@
 #include "../StorageDeviceFile.h"
 #include "../StorageDeviceInfo.h"
 #include "../native/native.h"
+#include "MetricsRegistry.h"
 
 namespace devlib {
     namespace impl {
@@ -35,11 +36,35 @@ private:
 
     auto seek_core(qint64) -> bool override;
 
-    void sync_core(void) override;
+    bool sync_core(void) override;
+
+    void setUmountPolicy_core(UmountPolicy const& policy) override {
+        _umountPolicy = policy;
+    }
+
+    void setAffinityPolicy_core(AffinityPolicy const& policy) override {
+        _affinity = policy;
+    }
+
+    auto busyMountpoints_core(void) const
+        -> QStringList override { return _busyMntpts; }
+
+    auto verify_core(QIODevice& source, qint64 length) -> VerifyResult override;
+    auto writeSparseImage_core(QIODevice& source) -> qint64 override;
+    auto backup_core(QString const& imagePath, BackupOptions const& options)
+        -> BackupResult override;
+    auto scan_core(ScanOptions const& options) -> HeatMap override;
+    auto probeCapacity_core(int samples, bool preserveContents)
+        -> CapacityProbeResult override;
+    auto classifySpeed_core(SpeedTestOptions const& options) -> SpeedClass override;
 
     QString _deviceFilename;
     std::shared_ptr<devlib::IStorageDeviceInfo> _deviceInfo;
     std::vector<std::unique_ptr<IMountpointLock>> _mntptsLocks;
+    UmountPolicy _umountPolicy;
+    AffinityPolicy _affinity;
+    QStringList _busyMntpts;
+    DeviceCounters& _metrics;
 
     std::unique_ptr<
         native::io::FileHandle
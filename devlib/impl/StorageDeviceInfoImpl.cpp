@@ -1,32 +1,38 @@
 #include "StorageDeviceInfoImpl.h"
-#include "native/native.h"
+#include "MountpointImpl.h"
+#include "PartitionImpl.h"
 
 
 devlib::impl::StorageDeviceInfoImpl::
-    StorageDeviceInfoImpl(int vid, int pid,
-                          QString const& filePath,
-                          QString const& usbPortPath,
-                          PartitionFactory_t partitionFactory,
-                          MountpointFactory_t mntptFactory)
-    : _vid(vid), _pid(pid),
-      _filePath(filePath),
-      _usbPortPath(usbPortPath),
-      _partitionFactory(partitionFactory),
-      _mountpointFactory(mntptFactory)
+    StorageDeviceInfoImpl(std::shared_ptr<DeviceEntry const> entry,
+                          std::shared_ptr<DeviceRegistry> registry)
+    : _entry(std::move(entry)),
+      _registry(std::move(registry))
 { }
 
 
+auto devlib::impl::StorageDeviceInfoImpl::attributes(void) const
+    -> native::DeviceAttributes const&
+{
+    std::call_once(_attributesLoaded, [this] () {
+        _attributes = native::deviceAttributes(std::get<2>(*_entry));
+    });
+
+    return _attributes;
+}
+
+
 auto devlib::impl::StorageDeviceInfoImpl::mountpoints_core(void) const
     -> std::vector<std::unique_ptr<IMountpoint>>
 {
-    auto mntpts = native::mntptsForPartition(_filePath);
+    auto mntpts = _registry->mountpoints(std::get<2>(*_entry));
     auto list = std::vector<
         std::unique_ptr<IMountpoint>
-    >(mntpts.size());
+    >(mntpts->size());
 
-    std::transform(mntpts.cbegin(), mntpts.cend(), list.begin(),
-        [this] (auto const& mntpt) {
-            return _mountpointFactory(mntpt.first);
+    std::transform(mntpts->cbegin(), mntpts->cend(), list.begin(),
+        [] (auto const& mntpt) {
+            return std::make_unique<MountpointImpl>(mntpt.first);
         }
     );
 
@@ -37,15 +43,16 @@ auto devlib::impl::StorageDeviceInfoImpl::mountpoints_core(void) const
 auto devlib::impl::StorageDeviceInfoImpl::partitions_core(void) const
     -> std::vector<std::unique_ptr<IPartition>>
 {
-    auto partitions = native::devicePartitions(_filePath);
+    auto partitions = _registry->partitions(std::get<2>(*_entry));
     auto list = std::vector<
         std::unique_ptr<IPartition>
-    >(partitions.size());
+    >(partitions->size());
 
-    std::transform(partitions.cbegin(), partitions.cend(), list.begin(),
-        [this] (auto const& part) {
-            return _partitionFactory(
-                std::get<0>(part), std::get<1>(part)
+    // aliasing pointers: every partition shares the list's control block
+    std::transform(partitions->cbegin(), partitions->cend(), list.begin(),
+        [this, &partitions] (auto const& part) {
+            return std::make_unique<PartitionImpl>(
+                std::shared_ptr<native::PartitionInfo const>(partitions, &part), _registry
             );
         }
     );
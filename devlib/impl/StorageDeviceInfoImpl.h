@@ -4,42 +4,55 @@
 #include "../StorageDeviceInfo.h"
 #include "../Mountpoint.h"
 #include "../Partition.h"
+#include "DeviceRegistry.h"
+
+#include <mutex>
 
 namespace devlib {
     namespace impl {
         class StorageDeviceInfoImpl;
-        using PartitionFactory_t =
-            std::function<
-                std::unique_ptr<devlib::IPartition>(QString const&, QString const&)
-            >;
-
-        using MountpointFactory_t = std::function<
-            std::unique_ptr<IMountpoint>(QString const& name)
-        >;
     }
 }
 
 
+// Points into the registry's immutable device list; partitions and
+// mountpoints are made on request from the registry's cached lists.
 class devlib::impl::StorageDeviceInfoImpl : public devlib::IStorageDeviceInfo
 {
 public:
-    StorageDeviceInfoImpl(
-            int vid, int pid,
-            QString const& filePath, QString const& usbPortPath,
-            impl::PartitionFactory_t  partitionFactory,
-            impl::MountpointFactory_t mntptFactory);
+    using DeviceEntry = DeviceRegistry::DeviceEntry;
+
+    StorageDeviceInfoImpl(std::shared_ptr<DeviceEntry const> entry,
+                          std::shared_ptr<impl::DeviceRegistry> registry);
 
     virtual ~StorageDeviceInfoImpl(void) = default;
 
 private:
-    virtual int vid_core(void) const noexcept override { return _vid; }
-    virtual int pid_core(void) const noexcept override { return _pid; }
+    virtual int vid_core(void) const noexcept override { return std::get<0>(*_entry); }
+    virtual int pid_core(void) const noexcept override { return std::get<1>(*_entry); }
 
     virtual auto filePath_core(void) const noexcept
-        -> QString  override { return _filePath; }
+        -> QString  override { return std::get<2>(*_entry); }
 
     auto usbPortPath_core(void) const noexcept
-        -> QString  override { return _usbPortPath; }
+        -> QString  override { return std::get<3>(*_entry); }
+
+    auto capacity_core(void) const
+        -> qint64 override { return attributes().capacity; }
+
+    auto serial_core(void) const
+        -> QString override { return attributes().serial; }
+
+    auto vendorName_core(void) const
+        -> QString override { return attributes().vendorName; }
+
+    auto model_core(void) const
+        -> QString override { return attributes().model; }
+
+    bool isRemovable_core(void) const override { return attributes().removable; }
+    bool isReadOnly_core(void) const override { return attributes().readOnly; }
+
+    auto attributes(void) const -> native::DeviceAttributes const&;
 
     virtual auto mountpoints_core(void) const
         -> std::vector<std::unique_ptr<IMountpoint>> override;
@@ -47,10 +60,11 @@ private:
     virtual auto partitions_core(void) const
         -> std::vector<std::unique_ptr<IPartition>> override;
 
-    int _vid, _pid;
-    QString _filePath, _usbPortPath;
-    impl::PartitionFactory_t  _partitionFactory;
-    impl::MountpointFactory_t _mountpointFactory;
+    std::shared_ptr<DeviceEntry const> _entry;
+    std::shared_ptr<impl::DeviceRegistry> _registry;
+
+    mutable std::once_flag _attributesLoaded;
+    mutable native::DeviceAttributes _attributes;
 };
 
 #endif // STORAGEDEVICEINFOIMPL_H
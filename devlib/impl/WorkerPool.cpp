@@ -0,0 +1,67 @@
+#include "WorkerPool.h"
+
+#include <QtCore>
+
+
+devlib::impl::WorkerPool::WorkerPool(int threadsCount, std::function<void(void)> setup)
+    : _stopping(false)
+{
+    Q_ASSERT(threadsCount > 0);
+
+    _threads.reserve(threadsCount);
+    for (auto i = 0; i < threadsCount; i++) {
+        _threads.emplace_back([this, setup] () {
+            if (setup) {
+                setup();
+            }
+            run();
+        });
+    }
+}
+
+
+devlib::impl::WorkerPool::~WorkerPool(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+
+    _wakeup.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+
+void devlib::impl::WorkerPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+
+    _wakeup.notify_one();
+}
+
+
+void devlib::impl::WorkerPool::run(void)
+{
+    for (;;) {
+        auto task = std::function<void()>();
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeup.wait(lock, [this] () { return _stopping || !_tasks.empty(); });
+
+            if (_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace devlib {
+    namespace impl {
+        class WorkerPool;
+    }
+}
+
+
+// Fixed number of threads fed from one FIFO queue.
+// Destructor runs the queued tasks to completion and joins.
+// `setup` runs first on every thread, e.g. to pin it.
+class devlib::impl::WorkerPool
+{
+public:
+    explicit WorkerPool(int threadsCount, std::function<void(void)> setup = nullptr);
+    ~WorkerPool(void);
+
+    WorkerPool(WorkerPool const&) = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+
+    template<typename Task>
+    auto submit(Task task) -> std::future<decltype(task())>
+    {
+        using Result = decltype(task());
+
+        auto packaged = std::make_shared<
+            std::packaged_task<Result()>
+        >(std::move(task));
+
+        auto future = packaged->get_future();
+        enqueue([packaged] () { (*packaged)(); });
+
+        return future;
+    }
+
+    auto threadsCount(void) const { return int(_threads.size()); }
+
+private:
+    void enqueue(std::function<void()> task);
+    void run(void);
+
+    std::mutex _mutex;
+    std::condition_variable _wakeup;
+    std::deque<std::function<void()>> _tasks;
+    bool _stopping;
+    std::vector<std::thread> _threads;
+};
+
+#endif // WORKERPOOL_H
@@ -1,11 +1,37 @@
 SOURCES += \
+    $$PWD/CapacityProbe.cpp \
+    $$PWD/DeviceBackup.cpp \
+    $$PWD/DeviceCloner.cpp \
+    $$PWD/DeviceRegistry.cpp \
+    $$PWD/DeviceScanner.cpp \
+    $$PWD/FlashDispatcher.cpp \
+    $$PWD/IoBuffer.cpp \
+    $$PWD/MetricsRegistry.cpp \
     $$PWD/PartitionImpl.cpp \
+    $$PWD/Placement.cpp \
+    $$PWD/ProbeQueue.cpp \
+    $$PWD/SparseImageWriter.cpp \
+    $$PWD/SpeedTest.cpp \
     $$PWD/StorageDeviceFileImpl.cpp \
     $$PWD/StorageDeviceInfoImpl.cpp \
+    $$PWD/WorkerPool.cpp \
 
 HEADERS += \
+    $$PWD/CapacityProbe.h \
+    $$PWD/DeviceBackup.h \
+    $$PWD/DeviceCloner.h \
+    $$PWD/DeviceRegistry.h \
+    $$PWD/DeviceScanner.h \
+    $$PWD/FlashDispatcher.h \
+    $$PWD/IoBuffer.h \
+    $$PWD/MetricsRegistry.h \
     $$PWD/MountpointImpl.h \
     $$PWD/PartitionImpl.h \
+    $$PWD/Placement.h \
+    $$PWD/ProbeQueue.h \
+    $$PWD/SparseImageWriter.h \
+    $$PWD/SpeedTest.h \
     $$PWD/StorageDeviceFileImpl.h \
     $$PWD/StorageDeviceInfoImpl.h \
+    $$PWD/WorkerPool.h \
     $$PWD/logging.h
@@ -0,0 +1,100 @@
+#include "crc32.h"
+
+#include <array>
+
+namespace {
+    auto makeCrc32Table(void) {
+        auto table = std::array<quint32, 256>();
+
+        for (auto i = 0u; i < table.size(); i++) {
+            auto value = quint32(i);
+            for (auto bit = 0; bit < 8; bit++) {
+                value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+            }
+            table[i] = value;
+        }
+
+        return table;
+    }
+
+
+    using Gf2Matrix = std::array<quint32, 32>;
+
+    auto gf2Times(Gf2Matrix const& matrix, quint32 vector) {
+        auto sum = quint32(0);
+        for (auto i = 0; vector != 0; i++, vector >>= 1) {
+            if (vector & 1) {
+                sum ^= matrix[i];
+            }
+        }
+        return sum;
+    }
+
+
+    auto gf2Square(Gf2Matrix const& matrix) {
+        auto square = Gf2Matrix();
+        for (auto i = 0u; i < square.size(); i++) {
+            square[i] = gf2Times(matrix, matrix[i]);
+        }
+        return square;
+    }
+}
+
+
+auto devlib::native::crc32(void const* data, qint64 size, quint32 crc)
+    -> quint32
+{
+    static auto const table = makeCrc32Table();
+    auto bytes = static_cast<uchar const*>(data);
+
+    crc = ~crc;
+    for (auto i = 0LL; i < size; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+
+// Feeding zero bytes is a linear map of the CRC register, so `count`
+// of them are applied by squaring the one-bit operator (as zlib's
+// crc32_combine does) instead of running the table over every byte.
+auto devlib::native::crc32Zeros(qint64 count, quint32 crc)
+    -> quint32
+{
+    if (count <= 0) {
+        return crc;
+    }
+
+    auto odd = Gf2Matrix();
+    odd[0] = 0xEDB88320u;
+    for (auto i = 1u; i < odd.size(); i++) {
+        odd[i] = 1u << (i - 1);
+    }
+
+    auto even = gf2Square(odd); // two zero bits
+    odd = gf2Square(even);      // four zero bits
+
+    auto reg = ~crc;
+    for (;;) {
+        even = gf2Square(odd);
+        if (count & 1) {
+            reg = gf2Times(even, reg);
+        }
+        count >>= 1;
+        if (count == 0) {
+            break;
+        }
+
+        odd = gf2Square(even);
+        if (count & 1) {
+            reg = gf2Times(odd, reg);
+        }
+        count >>= 1;
+        if (count == 0) {
+            break;
+        }
+    }
+
+    return ~reg;
+}
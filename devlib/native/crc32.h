@@ -0,0 +1,17 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <QtCore>
+
+namespace devlib {
+    namespace native {
+        // IEEE 802.3 CRC-32, as used by GPT and Android sparse images.
+        // Pass the previous result as `crc` to checksum data in pieces.
+        auto crc32(void const* data, qint64 size, quint32 crc = 0) -> quint32;
+
+        // Same as crc32() over `count` zero bytes, in O(log count) time
+        auto crc32Zeros(qint64 count, quint32 crc = 0) -> quint32;
+    }
+}
+
+#endif // CRC32_H
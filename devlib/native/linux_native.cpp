@@ -1,35 +1,40 @@
 #include "native.h"
+#include "linux_utils/linux_utils.h"
+#include "trace.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mount.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
+#include <poll.h>
+#include <linux/falloc.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
 
 #include <libudev.h>
 #include <blkid/blkid.h>
 
+#include <algorithm>
+#include <future>
 #include <memory>
+#include <thread>
 #include <tuple>
 #include <cstring>
 
 #include <QtCore>
 
 namespace linutil {
-    Q_LOGGING_CATEGORY(linuxlog, "linux_native");
-
-    static void errnoWarning(char const* function, QString const& message, int error) {
-        qCWarning(linuxlog()) << '[' << function << "]: "
-                              << message << '\n'
-                              << QString("\t[linux errno]: ") + std::strerror(error);
-    }
-
-
-    static void warning(char const* function, QString const& message) {
-        qCWarning(linuxlog()) << '[' << function << "]: "
-                              << message;
-    }
+    using linux_utils::linuxlog;
+    using linux_utils::errnoWarning;
+    using linux_utils::warning;
 
 
     struct LinLock : public devlib::native::LockHandle {
@@ -69,42 +74,329 @@ namespace linutil {
     }
 
 
-    static auto partitionsCount(QString const& deviceName)
+    // probes filesystem inside [start, start + size) of already opened disk
+    static void probeFilesystem(int fd, devlib::native::PartitionInfo& partition)
     {
-        auto asStdString = deviceName.toStdString();
-        auto probe = ::blkid_new_probe_from_filename(asStdString.data());
+        std::unique_ptr<blkid_struct_probe, decltype(&blkid_free_probe)>
+                probe(::blkid_new_probe(), &blkid_free_probe);
 
-        if (!probe) {
+        if (!probe || ::blkid_probe_set_device(probe.get(), fd,
+                                               partition.start, partition.size) != 0) {
             linutil::warning(__PRETTY_FUNCTION__,
-                  QString("Failed to create blkid probe for device: ")
-                      .append(deviceName)
+                  QString("Failed to create blkid probe for part: ")
+                      .append(partition.filePath)
                   );
-            return -1;
+            return;
+        }
+
+        ::blkid_probe_enable_superblocks(probe.get(), 1);
+        ::blkid_probe_set_superblocks_flags(probe.get(),
+                                            BLKID_SUBLKS_LABEL | BLKID_SUBLKS_TYPE);
+
+        if (::blkid_do_safeprobe(probe.get()) != 0) {
+            return;
+        }
+
+        auto valueOf = [&probe] (char const* param) {
+            char const* buffer = nullptr;
+            ::blkid_probe_lookup_value(probe.get(), param, &buffer, nullptr);
+            return buffer == nullptr ?
+                QString("") : QString(buffer);
+        };
+
+        partition.label  = valueOf("LABEL");
+        partition.fsType = valueOf("TYPE");
+    }
+
+    struct LinChangeMonitor : public devlib::native::ChangeMonitor
+    {
+        std::unique_ptr<udev, decltype(&udev_unref)> manager;
+        std::unique_ptr<udev_monitor, decltype(&udev_monitor_unref)> monitor;
+        int mountsFd;
+
+        LinChangeMonitor(void)
+            : manager(::udev_new(), &udev_unref),
+              monitor(nullptr, &udev_monitor_unref),
+              mountsFd(-1)
+        { }
+
+        ~LinChangeMonitor(void) {
+            if (mountsFd != -1) {
+                ::close(mountsFd);
+            }
+        }
+    };
+
+
+    static auto asLinChangeMonitor(devlib::native::ChangeMonitor* monitor) {
+        return dynamic_cast<LinChangeMonitor*>(monitor);
+    }
+
+
+    struct LinLocalServer : public devlib::native::LocalServer
+    {
+        int fd = -1;
+        int stopFd = -1;        // eventfd waking the serving thread up
+        QByteArray path;        // set once bound, unlinked on destruction
+        std::thread thread;
+
+        ~LinLocalServer(void) {
+            if (thread.joinable()) {
+                auto one = quint64(1);
+                if (::write(stopFd, &one, sizeof(one)) == sizeof(one)) {
+                    thread.join();
+                } else {
+                    thread.detach();
+                }
+            }
+            if (fd != -1) {
+                ::close(fd);
+            }
+            if (stopFd != -1) {
+                ::close(stopFd);
+            }
+            if (!path.isEmpty()) {
+                ::unlink(path.constData());
+            }
+        }
+    };
+
+
+    // a client reading slower than this is dropped
+    constexpr auto LocalServer_sendTimeoutMs = 1000;
+
+
+    // Writes the whole response to the nonblocking `client`. False if it
+    // stopped reading for LocalServer_sendTimeoutMs or the server is
+    // being stopped, so neither can hang the serving thread.
+    static bool sendResponse(int client, int stopFd, QByteArray const& response) {
+        for (auto written = qint64(0); written < response.size(); ) {
+            auto count = ::send(client, response.constData() + written,
+                                size_t(response.size() - written), MSG_NOSIGNAL);
+            if (count > 0) {
+                written += count;
+                continue;
+            }
+            if (count == -1 && errno == EINTR) {
+                continue;
+            }
+            if (count == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+
+            pollfd fds[] = { { client, POLLOUT, 0 }, { stopFd, POLLIN, 0 } };
+            auto ready = ::poll(fds, 2, LocalServer_sendTimeoutMs);
+            if (ready == -1 && errno == EINTR) {
+                continue;
+            }
+            if (ready <= 0 || fds[1].revents) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    // One connection at a time; clients are local and short-lived
+    static void serveConnections(int fd, int stopFd,
+                                 std::function<QByteArray(QByteArray const&)> const& respond)
+    {
+        for (;;) {
+            pollfd fds[] = { { fd, POLLIN, 0 }, { stopFd, POLLIN, 0 } };
+            if (::poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            if (fds[1].revents) {
+                return;
+            }
+            if (!(fds[0].revents & POLLIN)) {
+                continue;
+            }
+
+            auto client = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (client == -1) {
+                continue;
+            }
+
+            // HTTP clients speak first, raw ones (socat, nc) may not at all
+            auto request = QByteArray();
+            pollfd input = { client, POLLIN, 0 };
+            if (::poll(&input, 1, 100) > 0) {
+                char buffer[4096];
+                auto count = ::read(client, buffer, sizeof(buffer));
+                if (count > 0) {
+                    request = QByteArray(buffer, int(count));
+                }
+            }
+
+            if (!sendResponse(client, stopFd, respond(request))) {
+                linutil::warning(__PRETTY_FUNCTION__,
+                                 "client dropped before the whole response was sent");
+            }
+
+            ::close(client);
+        }
+    }
+
+
+    static auto probeFilesystemType(QString const& devFilePath) {
+        auto partition = devlib::native::PartitionInfo();
+        partition.filePath = devFilePath;
+
+        auto fd = ::open(devFilePath.toStdString().data(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return QString();
+        }
+
+        // zero size means "up to the end of the device"
+        probeFilesystem(fd, partition);
+        ::close(fd);
+
+        return partition.fsType;
+    }
+
+
+    // blkid names the filesystem, mount() wants the driver
+    static auto kernelFilesystemType(QString const& fsType) {
+        return fsType == "ntfs" ? QString("ntfs3") : fsType;
+    }
+
+
+    // Filesystems without ownership are handed over to the real user,
+    // so a privileged mount stays readable for the caller
+    static auto mountOptions(QString const& fsType) {
+        static auto const ownerless = QStringList{ "vfat", "exfat", "ntfs", "ntfs3" };
+
+        if (!ownerless.contains(fsType)) {
+            return QByteArray();
+        }
+
+        return QString("uid=%1,gid=%2").arg(::getuid()).arg(::getgid()).toLatin1();
+    }
+
+
+    // "0-3,8,10-11" as in sysfs cpulist files
+    static auto parseCpuList(QByteArray const& list) {
+        auto cpus = std::vector<int>();
+
+        for (auto const& range : list.trimmed().split(',')) {
+            auto bounds = range.split('-');
+            auto first = bounds.first().toInt();
+            auto last = bounds.size() > 1 ? bounds.last().toInt() : first;
+
+            for (auto cpu = first; !range.isEmpty() && cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
         }
 
-        auto partlist = ::blkid_probe_get_partitions(probe);
+        return cpus;
+    }
+
+
+    static auto readSysfsFile(QString const& path) {
+        QFile file(path);
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    }
+
+
+    static auto readUsbIds(udev_device* device) {
+        auto deviceVid = QString(::udev_device_get_property_value(device, "ID_VENDOR_ID"));
+        auto devicePid = QString(::udev_device_get_property_value(device, "ID_MODEL_ID"));
+
+        auto base = 16;
+        return std::make_pair(deviceVid.toInt(nullptr, base),
+                              devicePid.toInt(nullptr, base));
+    }
+
 
-        if (!partlist) {
-            qCWarning(linuxlog()) << "Device doesn't have any partitions.";
-            return 0;
+    static auto toChangeEvent(udev_device* device) {
+        auto event = devlib::native::ChangeEvent();
+        auto devtype = QString(::udev_device_get_devtype(device));
+
+        event.action = QString(::udev_device_get_action(device));
+        event.devicePath = QString(::udev_device_get_devnode(device));
+
+        if (devtype == "partition") {
+            auto parent = ::udev_device_get_parent_with_subsystem_devtype(
+                device, "block", "disk"
+            );
+
+            event.kind = devlib::native::ChangeKind::Partition;
+            event.parentPath = parent ?
+                QString(::udev_device_get_devnode(parent)) : QString();
+        } else {
+            auto ids = readUsbIds(device);
+
+            event.kind = devlib::native::ChangeKind::Device;
+            event.vid = ids.first;
+            event.pid = ids.second;
+            event.usbPortPath = linux_utils::extractUsbPortPath(::udev_device_get_syspath(device));
         }
 
-        auto partCount = ::blkid_partlist_numof_partitions(partlist);
+        return event;
+    }
+
 
-        ::blkid_free_probe(probe);
-        return partCount;
+    constexpr auto HugePageSize = qint64(2) * 1024 * 1024;
+    constexpr auto PageSize = qint64(4096);
+
+    static auto roundUp(qint64 size, qint64 granularity) {
+        return (size + granularity - 1) / granularity * granularity;
     }
 
-    static auto extractUsbPortPath(QString const& devicePath) {
-        return QString(devicePath)
-              //1-1.1.2
-              .replace(QRegularExpression(".*/(\\d+\-[\\d\.]+):.*"), "\\1");
+
+    // MAP_HUGETLB pages come from the reserved pool, so mmap fails
+    // right away when there are not enough of them
+    static auto mapHuge(qint64 size, int flags) -> char* {
+        auto data = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | flags, -1, 0);
+        return data == MAP_FAILED ? nullptr : static_cast<char*>(data);
+    }
+
+
+    // Huge page aligned so that khugepaged and the fault path can
+    // actually back it with huge pages: over-map, then trim both ends
+    static auto mapTransparent(qint64 size) -> char* {
+        auto span = size + HugePageSize;
+        auto data = ::mmap(nullptr, static_cast<size_t>(span), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            return nullptr;
+        }
+
+        auto begin = reinterpret_cast<quintptr>(data);
+        auto aligned = static_cast<quintptr>(roundUp(qint64(begin), HugePageSize));
+        auto head = aligned - begin;
+        auto tail = quintptr(span) - head - quintptr(size);
+
+        if (head > 0) {
+            ::munmap(data, head);
+        }
+        if (tail > 0) {
+            ::munmap(reinterpret_cast<void*>(aligned + quintptr(size)), tail);
+        }
+
+        return reinterpret_cast<char*>(aligned);
+    }
+
+
+    static void touchPages(char* data, qint64 size) {
+        auto volatile* pages = data;
+        for (auto offset = qint64(0); offset < size; offset += PageSize) {
+            pages[offset] = 0;
+        }
     }
 }
 
 auto devlib::native::umountPartition(QString const& mntpt)
     -> std::unique_ptr<LockHandle>
 {
+    trace::Span span("native", "umountPartition", mntpt);
+
     if (::umount2(mntpt.toStdString().data(), 0) != 0) {
         auto errnoCache = errno;
 
@@ -118,57 +410,190 @@ auto devlib::native::umountPartition(QString const& mntpt)
 }
 
 
-// Temporarily unsupported
-bool devlib::native::umountDisk(QString const & devicePath)
+auto devlib::native::umountDisk(QString const& devicePath,
+                                std::chrono::milliseconds deadline,
+                                bool lazyDetach) -> UmountReport
 {
-    Q_UNUSED(devicePath);
-    return false;
+    trace::Span span("native", "umountDisk", devicePath);
+
+    using Clock = std::chrono::steady_clock;
+
+    auto report = UmountReport{ UmountStatus::Unmounted, {}, {} };
+    auto device = linux_utils::blockDeviceNumber(devicePath);
+
+    if (device == 0) {
+        report.status = UmountStatus::NotHandled;
+        return report;
+    }
+
+    auto entries = linux_utils::MountTable::instance().entriesFor(device);
+    auto until = Clock::now() + deadline;
+
+    // nested mountpoints sort themselves out: the outer one keeps
+    // getting EBUSY until the inner one is gone
+    auto attempts = std::vector<std::future<bool>>();
+    attempts.reserve(entries.size());
+
+    for (auto const& entry : entries) {
+        attempts.push_back(std::async(std::launch::async,
+            [mntpt = entry.mountpoint.toStdString(), until] () {
+                auto backoff = std::chrono::milliseconds(5);
+
+                for (;;) {
+                    if (::umount2(mntpt.data(), 0) == 0) {
+                        return true;
+                    }
+
+                    auto errnoCache = errno;
+                    if (errnoCache == EINVAL || errnoCache == ENOENT) {
+                        return true; // already gone
+                    }
+
+                    if (errnoCache != EBUSY || Clock::now() + backoff > until) {
+                        return false;
+                    }
+
+                    std::this_thread::sleep_for(backoff);
+                    backoff = std::min(backoff * 2, std::chrono::milliseconds(200));
+                }
+            }
+        ));
+    }
+
+    for (auto i = std::size_t(0); i < entries.size(); i++) {
+        if (attempts.at(i).get()) {
+            continue;
+        }
+
+        auto const& mntpt = entries.at(i).mountpoint;
+        if (lazyDetach && ::umount2(mntpt.toStdString().data(), MNT_DETACH) == 0) {
+            report.detachedMountpoints.push_back(mntpt);
+            continue;
+        }
+
+        linutil::warning(__PRETTY_FUNCTION__,
+                      QString("mountpoint is busy: ").append(mntpt));
+        report.busyMountpoints.push_back(mntpt);
+    }
+
+    if (!report.busyMountpoints.empty()) {
+        report.status = UmountStatus::Busy;
+    }
+
+    return report;
 }
 
 
-bool devlib::native::mount(QString const& dev, QString const& path)
+bool devlib::native::mount(QString const& dev, QString const& path, QString const& fsType)
 {
-    QProcess mount;
-    mount.start(QString("mount %1 %2").arg(dev).arg(path));
-    mount.waitForFinished();
-    return mount.exitCode() == 0;
+    trace::Span span("native", "mount", dev);
+
+    auto type = fsType.isEmpty() ? linutil::probeFilesystemType(dev) : fsType;
+
+    if (type.isEmpty()) {
+        linutil::warning(__PRETTY_FUNCTION__,
+                      QString("unknown filesystem on ").append(dev));
+        return false;
+    }
+
+    auto mountAs = [&dev, &path] (QString const& driver) {
+        auto options = linutil::mountOptions(driver);
+        return ::mount(dev.toStdString().data(),
+                       path.toStdString().data(),
+                       driver.toStdString().data(),
+                       MS_NOSUID | MS_NODEV,
+                       options.isEmpty() ? nullptr : options.constData());
+    };
+
+    auto driver = linutil::kernelFilesystemType(type);
+    auto result = mountAs(driver);
+
+    // kernels before 5.15 have the read-only "ntfs" driver only
+    if (result != 0 && errno == ENODEV && driver != type) {
+        result = mountAs(type);
+    }
+
+    if (result != 0) {
+        auto errnoCache = errno;
+        linutil::errnoWarning(__PRETTY_FUNCTION__,
+                      QString("can not mount %1 to %2 as %3").arg(dev).arg(path).arg(type),
+                      errnoCache);
+        return false;
+    }
+
+    return true;
 }
 
 
 std::vector<QString> devlib::native::mntptsList(void)
 {
-    auto mntptsInfo = QStorageInfo::mountedVolumes();
-    auto mntpts = std::vector<QString>();
-    mntpts.reserve(mntptsInfo.size());
+    auto entries = linux_utils::MountTable::instance().entries();
+    auto mntpts = std::vector<QString>(entries.size());
 
-    std::transform(mntptsInfo.cbegin(), mntptsInfo.cend(), mntpts.begin(),
-        [] (auto const& info) { return info.rootPath(); }
+    std::transform(entries.cbegin(), entries.cend(), mntpts.begin(),
+        [] (auto const& entry) { return entry.mountpoint; }
     );
 
     return mntpts;
 }
 
 
+bool devlib::native::isMountpoint(QString const& mntpt)
+{
+    return linux_utils::MountTable::instance().isMountpoint(mntpt);
+}
+
 
 std::vector<std::pair<QString, QString>> devlib::native::mntptsForPartition(QString const& devFilePath) {
-    auto mntptsInfo = QStorageInfo::mountedVolumes();
+    trace::Span span("native", "mntptsForPartition", devFilePath);
+
+    auto device = linux_utils::blockDeviceNumber(devFilePath);
     auto mntpts = std::vector<std::pair<QString, QString>>();
 
-    for (auto const& mntpt : mntptsInfo) {
-        if (QString(mntpt.device()).startsWith(devFilePath)) {
-            mntpts.emplace_back(mntpt.rootPath(), mntpt.device());
-        }
+    if (device == 0) {
+        return mntpts;
+    }
+
+    for (auto const& entry : linux_utils::MountTable::instance().entriesFor(device)) {
+        mntpts.emplace_back(entry.mountpoint, entry.source);
     }
 
     return mntpts;
 }
 
 
+void devlib::native::setSystemRoots(SystemRoots const& roots)
+{
+    linux_utils::setRoots(roots);
+
+    // both keep descriptors of the old roots open
+    linux_utils::MountTable::instance().reopen();
+    linux_utils::SysfsScanner::instance().reopen();
+}
+
+
+auto devlib::native::systemRoots(void)
+    -> SystemRoots
+{
+    return linux_utils::roots();
+}
+
+
 std::vector<std::tuple<int, int, QString, QString>>
-    devlib::native::requestUsbDeviceList(void)
+    devlib::native::requestUsbDeviceList(DiscoveryBackend backend)
 {
+    trace::Span span("native", "requestUsbDeviceList");
+
     auto storageDeviceList = std::vector<std::tuple<int, int, QString, QString>>();
 
+    if (backend == DiscoveryBackend::Sysfs) {
+        for (auto const& disk : linux_utils::SysfsScanner::instance().disks()) {
+            storageDeviceList.emplace_back(disk.vid, disk.pid,
+                                           disk.devicePath, disk.usbPortPath);
+        }
+        return storageDeviceList;
+    }
+
     std::unique_ptr<udev, decltype(&udev_unref)>
             manager(::udev_new(), &udev_unref);
 
@@ -191,14 +616,12 @@ std::vector<std::tuple<int, int, QString, QString>>
             continue;
         }
 
-        auto deviceVid = QString(::udev_device_get_property_value(device.get(), "ID_VENDOR_ID"));
-        auto devicePid = QString(::udev_device_get_property_value(device.get(), "ID_MODEL_ID"));
-        auto usbPortPath = QString(linutil::extractUsbPortPath(path));
+        auto ids = linutil::readUsbIds(device.get());
+        auto usbPortPath = linux_utils::extractUsbPortPath(path);
         auto diskPath  = QString(::udev_device_get_devnode(device.get()));
 
-        auto base = 16;
-        auto storageDevInfo = std::make_tuple(deviceVid.toInt(nullptr, base),
-                                              devicePid.toInt(nullptr, base),
+        auto storageDevInfo = std::make_tuple(ids.first,
+                                              ids.second,
                                               diskPath,
                                               usbPortPath);
         storageDeviceList.push_back(storageDevInfo);
@@ -212,46 +635,388 @@ std::vector<std::tuple<int, int, QString, QString>>
 
 
 auto devlib::native::devicePartitions(QString const& deviceName)
-    -> std::vector<std::tuple<QString, QString>>
+    -> std::vector<PartitionInfo>
 {
-    auto partitions = std::vector<std::tuple<QString, QString>>();
-    auto partsCount = linutil::partitionsCount(deviceName);
+    trace::Span span("native", "devicePartitions", deviceName);
+
+    auto partitions = std::vector<PartitionInfo>();
+    auto fd = ::open(deviceName.toStdString().data(), O_RDONLY | O_CLOEXEC);
 
-    if (partsCount <= 0) {
+    if (fd == -1) {
+        auto errnoCache = errno;
+        linutil::errnoWarning(__PRETTY_FUNCTION__,
+                      QString("can not open device ").append(deviceName),
+                      errnoCache);
         return partitions;
     }
 
-    auto valueOf =[] (auto& param, auto& probe, auto buffer) {
-        ::blkid_probe_lookup_value(probe, param, &buffer, nullptr);
-        return buffer == nullptr ?
-            QString("") : QString(buffer);
+    // every partition is probed through this single descriptor
+    auto entries = linux_utils::readPartitionTable(fd, linux_utils::sectorSize(fd));
+    partitions.reserve(entries.size());
+
+    for (auto const& entry : entries) {
+        auto partition = PartitionInfo();
+        partition.filePath = linux_utils::partitionNodePath(deviceName, entry.number);
+        partition.typeId = entry.typeId;
+        partition.uuid = entry.uuid;
+        partition.name = entry.name;
+        partition.start = entry.start;
+        partition.size = entry.size;
+
+        linutil::probeFilesystem(fd, partition);
+        partitions.push_back(partition);
+    }
+
+    ::close(fd);
+    return partitions;
+}
+
+
+auto devlib::native::deviceAttributes(QString const& devicePath)
+    -> DeviceAttributes
+{
+    trace::Span span("native", "deviceAttributes", devicePath);
+
+    auto attributes = DeviceAttributes();
+    auto sysfsDisk = QDir(linux_utils::sysfsBlockDir(devicePath));
+
+    auto attribute = [&sysfsDisk] (char const* name) {
+        return linux_utils::readAttribute(sysfsDisk.filePath(name));
     };
 
-    for (auto i = 1; i <= partsCount; i++) {
-        auto partName = deviceName;
-        partName.append(QString::number(i));
+    // "size" is in 512-byte units whatever the logical sector size is
+    attributes.capacity = attribute("size").toLongLong() * 512;
+    attributes.removable = attribute("removable") == "1";
+    attributes.readOnly = attribute("ro") == "1";
 
-        auto probe = ::blkid_new_probe_from_filename(partName.toStdString().data());
+    auto properties = linux_utils::udevProperties(
+        linux_utils::blockDeviceNumber(devicePath)
+    );
 
-        if (!probe) {
-            linutil::warning(__PRETTY_FUNCTION__,
-                          QString("Failed to create blkid probe for part: ")
-                              .append(partName)
-                          );
-            continue;
+    auto property = [&properties] (char const* name, QByteArray const& fallback) {
+        auto value = properties.value(name);
+        return QString(value.isEmpty() ? fallback : value);
+    };
+
+    attributes.serial = property("ID_SERIAL_SHORT", QByteArray());
+    attributes.vendorName = property("ID_VENDOR", attribute("device/vendor"));
+    attributes.model = property("ID_MODEL", attribute("device/model"));
+
+    return attributes;
+}
+
+
+auto devlib::native::makeChangeMonitor(void)
+    -> std::unique_ptr<ChangeMonitor>
+{
+    auto changeMonitor = std::make_unique<linutil::LinChangeMonitor>();
+
+    if (!changeMonitor->manager) {
+        linutil::warning(__PRETTY_FUNCTION__, "can not create udev context");
+        return nullptr;
+    }
+
+    changeMonitor->monitor.reset(
+        ::udev_monitor_new_from_netlink(changeMonitor->manager.get(), "udev")
+    );
+
+    if (!changeMonitor->monitor) {
+        linutil::warning(__PRETTY_FUNCTION__, "can not create udev monitor");
+        return nullptr;
+    }
+
+    ::udev_monitor_filter_add_match_subsystem_devtype(
+        changeMonitor->monitor.get(), "block", nullptr
+    );
+
+    if (::udev_monitor_enable_receiving(changeMonitor->monitor.get()) < 0) {
+        linutil::warning(__PRETTY_FUNCTION__, "can not enable udev monitor");
+        return nullptr;
+    }
+
+    // kernel reports mount table changes as POLLPRI on this file
+    changeMonitor->mountsFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if (changeMonitor->mountsFd == -1) {
+        auto errnoCache = errno;
+        linutil::errnoWarning(__PRETTY_FUNCTION__,
+                      QString("can not open mountinfo"),
+                      errnoCache);
+        return nullptr;
+    }
+
+    return changeMonitor;
+}
+
+
+auto devlib::native::serveLocalSocket(QString const& path,
+                                      std::function<QByteArray(QByteArray const&)> respond)
+    -> std::unique_ptr<LocalServer>
+{
+    auto server = std::make_unique<linutil::LinLocalServer>();
+    auto encoded = QFile::encodeName(path);
+
+    auto address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    if (encoded.isEmpty() || size_t(encoded.size()) >= sizeof(address.sun_path)) {
+        linutil::warning(__PRETTY_FUNCTION__, QString("bad socket path ").append(path));
+        return nullptr;
+    }
+    std::memcpy(address.sun_path, encoded.constData(), size_t(encoded.size()));
+
+    server->fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    server->stopFd = ::eventfd(0, EFD_CLOEXEC);
+    if (server->fd == -1 || server->stopFd == -1) {
+        auto errnoCache = errno;
+        linutil::errnoWarning(__PRETTY_FUNCTION__, QString("can not create socket"), errnoCache);
+        return nullptr;
+    }
+
+    // left behind by an earlier process; anything else stays untouched
+    struct stat existing;
+    if (::lstat(encoded.constData(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        ::unlink(encoded.constData());
+    }
+
+    if (::bind(server->fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || ::listen(server->fd, 8) != 0) {
+        auto errnoCache = errno;
+        linutil::errnoWarning(__PRETTY_FUNCTION__,
+                      QString("can not listen on ").append(path),
+                      errnoCache);
+        return nullptr;
+    }
+    server->path = encoded;
+
+    auto fd = server->fd;
+    auto stopFd = server->stopFd;
+    server->thread = std::thread([fd, stopFd, respond] () {
+        linutil::serveConnections(fd, stopFd, respond);
+    });
+
+    return server;
+}
+
+
+auto devlib::native::pollChanges(ChangeMonitor* monitor)
+    -> std::vector<ChangeEvent>
+{
+    Q_ASSERT(monitor);
+    auto linMonitor = linutil::asLinChangeMonitor(monitor);
+    auto events = std::vector<ChangeEvent>();
+
+    ::pollfd fds[] = {
+        { ::udev_monitor_get_fd(linMonitor->monitor.get()), POLLIN, 0 },
+        { linMonitor->mountsFd, POLLPRI, 0 }
+    };
+
+    if (::poll(fds, 2, 0) <= 0) {
+        return events;
+    }
+
+    if (fds[0].revents & POLLIN) {
+        while (auto device = ::udev_monitor_receive_device(linMonitor->monitor.get())) {
+            events.push_back(linutil::toChangeEvent(device));
+            ::udev_device_unref(device);
+        }
+    }
+
+    if (fds[1].revents & (POLLPRI | POLLERR)) {
+        auto event = ChangeEvent();
+        event.kind = ChangeKind::MountTable;
+        events.push_back(event);
+    }
+
+    return events;
+}
+
+
+auto devlib::native::affinity::nodeCpus(int node)
+    -> std::vector<int>
+{
+    if (node < 0) {
+        return {};
+    }
+
+    return linutil::parseCpuList(linutil::readSysfsFile(
+        QString("/sys/devices/system/node/node%1/cpulist").arg(node)
+    ));
+}
+
+
+auto devlib::native::affinity::cpuNode(int cpu)
+    -> int
+{
+    // cpuN/nodeM link, present on NUMA kernels only
+    auto entries = QDir(QString("/sys/devices/system/cpu/cpu%1").arg(cpu))
+        .entryList({ "node*" }, QDir::Dirs | QDir::System);
+
+    for (auto const& entry : entries) {
+        auto ok = false;
+        auto node = entry.mid(4).toInt(&ok);
+        if (ok) {
+            return node;
         }
+    }
 
-        char const* buffer = nullptr;
+    return -1;
+}
 
-        ::blkid_do_probe(probe);
-        auto partLabel = valueOf("LABEL", probe, buffer);
-        auto fstype    = valueOf("TYPE", probe, buffer);
-        ::blkid_free_probe(probe);
 
-        partitions.push_back(std::make_tuple(partName, partLabel));
+auto devlib::native::affinity::deviceNode(QString const& devicePath)
+    -> int
+{
+    // the block device's sysfs path runs through its PCI controller,
+    // the closest numa_node up the tree is the controller's one
+    auto sysPath = QFileInfo("/sys/class/block/" + QFileInfo(devicePath).fileName())
+        .canonicalFilePath();
+
+    for (auto dir = QDir(sysPath); !sysPath.isEmpty() && !dir.isRoot(); ) {
+        auto node = linutil::readSysfsFile(dir.filePath("numa_node"));
+        if (!node.isEmpty()) {
+            return qMax(node.trimmed().toInt(), -1);
+        }
+
+        if (!dir.cdUp() || dir.path() == "/sys") {
+            break;
+        }
     }
 
-    return partitions;
+    return -1;
+}
+
+
+bool devlib::native::affinity::pinCurrentThread(std::vector<int> const& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (auto cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    auto error = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+        linutil::errnoWarning(__PRETTY_FUNCTION__, "can not pin thread", error);
+        return false;
+    }
+
+    return true;
+}
+
+
+auto devlib::native::affinity::currentThreadCpus(void)
+    -> std::vector<int>
+{
+    auto cpus = std::vector<int>();
+
+    cpu_set_t set;
+    if (::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set) != 0) {
+        return cpus;
+    }
+
+    for (auto cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+
+auto devlib::native::affinity::currentCpu(void)
+    -> int
+{
+    return ::sched_getcpu();
+}
+
+
+bool devlib::native::affinity::preferNode(void* data, qint64 size, int node)
+{
+    Q_ASSERT(data);
+
+    auto mask = 0ul;
+    if (node < 0 || node >= int(sizeof(mask) * 8) - 1) {
+        return false;
+    }
+    mask = 1ul << node;
+
+    // no libnuma dependency for a single call
+    auto result = ::syscall(SYS_mbind, data, static_cast<unsigned long>(size),
+                            MPOL_PREFERRED, &mask, sizeof(mask) * 8, MPOL_MF_MOVE);
+    return result == 0;
+}
+
+
+auto devlib::native::memory::map(qint64 size, Pages pages, int node,
+                                 bool prefault, bool lock)
+    -> Mapping
+{
+    Q_ASSERT(size > 0);
+
+    auto mapping = Mapping();
+
+    // populated now the pages would be placed before mbind gets a say
+    auto populate = prefault && node < 0 ? MAP_POPULATE : 0;
+
+    if (pages == Pages::Huge) {
+        mapping.size = linutil::roundUp(size, linutil::HugePageSize);
+        mapping.data = linutil::mapHuge(mapping.size, populate);
+        mapping.pages = Pages::Huge;
+
+        if (!mapping.data) {
+            pages = Pages::Transparent;
+        }
+    }
+
+    if (!mapping.data && pages == Pages::Transparent) {
+        mapping.size = linutil::roundUp(size, linutil::HugePageSize);
+        mapping.data = linutil::mapTransparent(mapping.size);
+        mapping.pages = Pages::Transparent;
+
+        // THP disabled or unsupported: the mapping still works, with small pages
+        if (mapping.data && ::madvise(mapping.data, static_cast<size_t>(mapping.size),
+                                      MADV_HUGEPAGE) != 0) {
+            mapping.pages = Pages::Normal;
+        }
+    }
+
+    if (!mapping.data) {
+        mapping.size = linutil::roundUp(size, linutil::PageSize);
+        mapping.pages = Pages::Normal;
+
+        auto data = ::mmap(nullptr, static_cast<size_t>(mapping.size), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | populate, -1, 0);
+        if (data == MAP_FAILED) {
+            return Mapping();
+        }
+        mapping.data = static_cast<char*>(data);
+    }
+
+    if (node >= 0) {
+        affinity::preferNode(mapping.data, mapping.size, node);
+    }
+
+    // MAP_POPULATE did it already unless the pages waited for mbind or THP
+    if (prefault && (node >= 0 || mapping.pages == Pages::Transparent)) {
+        linutil::touchPages(mapping.data, mapping.size);
+    }
+
+    if (lock) {
+        mapping.locked = ::mlock(mapping.data, static_cast<size_t>(mapping.size)) == 0;
+    }
+
+    return mapping;
+}
+
+
+void devlib::native::memory::unmap(Mapping const& mapping)
+{
+    if (mapping.data) {
+        ::munmap(mapping.data, static_cast<size_t>(mapping.size));
+    }
 }
 
 
@@ -274,6 +1039,8 @@ auto devlib::native::io::
 auto devlib::native::io::open(char const* filename)
     -> std::unique_ptr<FileHandle>
 {
+    trace::Span span("native", "open");
+
     auto fd = ::open(filename, O_RDWR | O_SYNC);
     if (fd == -1) {
         auto errnoCache = errno;
@@ -296,6 +1063,98 @@ auto devlib::native::io::authOpen(char const* filename)
 }
 
 
+auto devlib::native::io::openDirect(char const* filename, bool exclusive)
+    -> std::unique_ptr<FileHandle>
+{
+    trace::Span span("native", "openDirect");
+
+    // O_EXCL on a block device: EBUSY while mounted, blocks mounting
+    auto flags = O_RDONLY | O_CLOEXEC | (exclusive ? O_EXCL : 0);
+    auto fd = ::open(filename, flags | O_DIRECT);
+
+    if (fd == -1 && errno == EINVAL) {
+        // filesystem without O_DIRECT support (tmpfs images):
+        // drop the cached pages instead
+        fd = ::open(filename, flags);
+        if (fd != -1) {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        }
+    }
+
+    if (fd == -1) {
+        auto errnoCache = errno;
+        linutil::errnoWarning(__PRETTY_FUNCTION__,
+                      QString("can not open file ").append(filename),
+                      errnoCache);
+        return nullptr;
+    }
+
+    return linutil::makeFileHandle(fd);
+}
+
+
+auto devlib::native::io::readAt(FileHandle* handle, char* data, qint64 sz, qint64 pos)
+    -> qint64
+{
+    Q_ASSERT(handle);
+    auto linHandle = linutil::asLinFileHandle(handle);
+    auto total = qint64(0);
+
+    while (total < sz) {
+        auto count = ::pread(linHandle->fd, data + total, sz - total, pos + total);
+
+        if (count == -1 && errno == EINTR) {
+            continue;
+        }
+        if (count == -1) {
+            auto errnoCache = errno;
+            linutil::errnoWarning(__PRETTY_FUNCTION__,
+                          QString("can not read at %1").arg(pos + total),
+                          errnoCache);
+            return total > 0 ? total : -1;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        total += count;
+    }
+
+    return total;
+}
+
+
+auto devlib::native::io::writeAt(FileHandle* handle, char const* data, qint64 sz, qint64 pos)
+    -> qint64
+{
+    Q_ASSERT(handle);
+    auto linHandle = linutil::asLinFileHandle(handle);
+    auto total = qint64(0);
+
+    while (total < sz) {
+        auto count = ::pwrite(linHandle->fd, data + total, sz - total, pos + total);
+
+        if (count == -1 && errno == EINTR) {
+            continue;
+        }
+        if (count == -1) {
+            auto errnoCache = errno;
+            linutil::errnoWarning(__PRETTY_FUNCTION__,
+                          QString("can not write at %1").arg(pos + total),
+                          errnoCache);
+            return total > 0 ? total : -1;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        total += count;
+    }
+
+    return total;
+}
+
+
 auto devlib::native::io::seek(FileHandle* handle, qint64 pos)
    -> bool
 {
@@ -305,14 +1164,51 @@ auto devlib::native::io::seek(FileHandle* handle, qint64 pos)
 }
 
 
-void devlib::native::io::sync(FileHandle* handle)
+bool devlib::native::io::zeroRange(FileHandle* handle, qint64 pos, qint64 size)
+{
+    trace::Span span("native", "zeroRange");
+
+    Q_ASSERT(handle);
+    auto linHandle = linutil::asLinFileHandle(handle);
+
+    struct stat info;
+    if (::fstat(linHandle->fd, &info) != 0) {
+        return false;
+    }
+
+    if (S_ISBLK(info.st_mode)) {
+        quint64 range[2] = { quint64(pos), quint64(size) };
+        return ::ioctl(linHandle->fd, BLKZEROOUT, range) == 0;
+    }
+
+    // image files: allocated zeroes, or a hole where ZERO_RANGE is missing
+    return ::fallocate(linHandle->fd, FALLOC_FL_ZERO_RANGE, pos, size) == 0;
+}
+
+
+bool devlib::native::io::sync(FileHandle* handle)
 {
+    trace::Span span("native", "sync");
+
     Q_ASSERT(handle);
     auto linHandle = linutil::asLinFileHandle(handle);
+
+    // reports write-back errors of everything written through the handle
+    if (::fsync(linHandle->fd) != 0) {
+        auto errnoCache = errno;
+        linutil::errnoWarning(__PRETTY_FUNCTION__,
+                      QString("fsync fails"),
+                      errnoCache);
+        return false;
+    }
+
+    // only drops the page cache, data is already on the device
     if (::ioctl(linHandle->fd, BLKFLSBUF) != 0) {
         auto errnoCache = errno;
         linutil::errnoWarning(__PRETTY_FUNCTION__,
                       QString("ioctl fails"),
                       errnoCache);
     }
+
+    return true;
 }
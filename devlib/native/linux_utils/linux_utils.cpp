@@ -0,0 +1,159 @@
+#include "linux_utils.h"
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+    std::mutex Roots_mutex;
+    devlib::native::SystemRoots Roots_current;
+}
+
+
+namespace linux_utils {
+    Q_LOGGING_CATEGORY(linuxlog, "linux_native");
+
+
+    auto roots(void) -> devlib::native::SystemRoots {
+        std::lock_guard<std::mutex> lock(Roots_mutex);
+        return Roots_current;
+    }
+
+
+    void setRoots(devlib::native::SystemRoots const& roots) {
+        std::lock_guard<std::mutex> lock(Roots_mutex);
+        Roots_current = roots;
+    }
+
+    void errnoWarning(char const* function, QString const& message, int error) {
+        qCWarning(linuxlog()) << '[' << function << "]: "
+                              << message << '\n'
+                              << QString("\t[linux errno]: ") + std::strerror(error);
+    }
+
+
+    void warning(char const* function, QString const& message) {
+        qCWarning(linuxlog()) << '[' << function << "]: "
+                              << message;
+    }
+
+
+    auto sectorSize(int fd) -> int {
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && !S_ISBLK(info.st_mode)) {
+            return 512;
+        }
+
+        auto size = 0;
+        if (::ioctl(fd, BLKSSZGET, &size) != 0 || size <= 0) {
+            return 512;
+        }
+
+        return size;
+    }
+
+
+    auto deviceSize(int fd) -> qint64 {
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            return 0;
+        }
+
+        if (!S_ISBLK(info.st_mode)) {
+            return S_ISREG(info.st_mode) ? qint64(info.st_size) : 0;
+        }
+
+        auto size = quint64(0);
+        if (::ioctl(fd, BLKGETSIZE64, &size) != 0) {
+            return 0;
+        }
+
+        return qint64(size);
+    }
+
+
+    auto readAttribute(QString const& path) -> QByteArray {
+        QFile attribute(path);
+        if (!attribute.open(QIODevice::ReadOnly)) {
+            return {};
+        }
+
+        return attribute.readAll().trimmed();
+    }
+
+
+    auto extractUsbPortPath(QString const& devicePath) -> QString {
+        // .../usb1/1-1/1-1.2/1-1.2:1.0/host3/... -> 1-1.2
+        auto segments = devicePath.split('/');
+
+        for (auto it = segments.crbegin(); it != segments.crend(); ++it) {
+            auto portPath = it->section(':', 0, 0);
+            auto dash = portPath.indexOf('-');
+
+            if (it->contains(':') && dash > 0 && dash < portPath.size() - 1) {
+                auto bus = portPath.leftRef(dash);
+                auto ports = portPath.midRef(dash + 1);
+
+                auto isBus = std::all_of(bus.cbegin(), bus.cend(),
+                    [] (QChar ch) { return ch.isDigit(); });
+                auto isPorts = std::all_of(ports.cbegin(), ports.cend(),
+                    [] (QChar ch) { return ch.isDigit() || ch == '.'; });
+
+                if (isBus && isPorts) {
+                    return portPath;
+                }
+            }
+        }
+
+        return devicePath;
+    }
+
+
+    auto sysfsBlockDir(QString const& devicePath) -> QString {
+        auto name = QFileInfo(QFileInfo(devicePath).canonicalFilePath()).fileName();
+        return QString("%1/class/block/%2").arg(roots().sys).arg(name);
+    }
+
+
+    auto udevProperties(dev_t device) -> QHash<QByteArray, QByteArray> {
+        auto properties = QHash<QByteArray, QByteArray>();
+        auto database = readAttribute(
+            QString("%1/data/b%2:%3").arg(roots().udev).arg(major(device)).arg(minor(device))
+        );
+
+        for (auto const& line : database.split('\n')) {
+            if (!line.startsWith("E:")) {
+                continue;
+            }
+
+            auto separator = line.indexOf('=');
+            if (separator > 2) {
+                properties.insert(line.mid(2, separator - 2), line.mid(separator + 1));
+            }
+        }
+
+        return properties;
+    }
+
+
+    auto partitionNodePath(QString const& diskPath, int number) -> QString {
+        auto sysfsDisk = QDir(sysfsBlockDir(diskPath));
+
+        auto entries = sysfsDisk.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (auto const& entry : entries) {
+            auto partition = readAttribute(sysfsDisk.filePath(entry + "/partition"));
+            if (!partition.isEmpty() && partition.toInt() == number) {
+                return QString("%1/%2").arg(roots().dev).arg(entry);
+            }
+        }
+
+        // sda -> sda1, mmcblk0 -> mmcblk0p1, nvme0n1 -> nvme0n1p1
+        auto separator = diskPath.at(diskPath.size() - 1).isDigit() ? "p" : "";
+        return QString("%1%2%3").arg(diskPath).arg(separator).arg(number);
+    }
+}
@@ -0,0 +1,156 @@
+#ifndef LINUX_UTILS_H
+#define LINUX_UTILS_H
+
+#include "../native.h"
+
+#include <sys/types.h>
+#include <dirent.h>
+
+#include <mutex>
+#include <unordered_map>
+
+#include <QtCore>
+
+
+namespace linux_utils {
+    Q_DECLARE_LOGGING_CATEGORY(linuxlog);
+
+    void errnoWarning(char const* function, QString const& message, int error);
+
+    void warning(char const* function, QString const& message);
+
+
+    // Current devlib::native::SystemRoots
+    auto roots(void) -> devlib::native::SystemRoots;
+    void setRoots(devlib::native::SystemRoots const& roots);
+
+
+    struct PartitionTableEntry {
+        int number;
+        qint64 start;   // bytes
+        qint64 size;    // bytes
+        QString typeId; // GPT type GUID or MBR type as "0x0c"
+        QString uuid;   // the same value blkid reports as PARTUUID
+        QString name;   // GPT partition name, empty for MBR
+    };
+
+    // Parses MBR (with logical partitions) or GPT of the opened disk.
+    // Header sectors and the GPT entry array are read in one pread each.
+    // Empty for a filesystem without partition table ("superfloppy")
+    // and for tables with invalid entries.
+    auto readPartitionTable(int fd, int sectorSize)
+        -> std::vector<PartitionTableEntry>;
+
+    // Logical sector size of the disk, 512 for image files
+    auto sectorSize(int fd) -> int;
+
+    // Size of the opened disk or image in bytes, 0 if unknown
+    auto deviceSize(int fd) -> qint64;
+
+    struct MountEntry {
+        dev_t device;   // mounted block device (or anonymous device)
+        dev_t disk;     // whole disk the device belongs to
+        QString mountpoint;
+        QString source;
+        QString fsType;
+    };
+
+    // Index over /proc/self/mountinfo keyed by major:minor.
+    // The file is parsed again only after poll() reports POLLPRI on it.
+    class MountTable
+    {
+    public:
+        static auto instance(void) -> MountTable&;
+
+        auto entries(void) -> std::vector<MountEntry>;
+
+        // mounts of the device; for a whole disk includes its partitions
+        auto entriesFor(dev_t device) -> std::vector<MountEntry>;
+
+        bool isMountpoint(QString const& path);
+
+        // mountinfo of the current roots from now on
+        void reopen(void);
+
+        ~MountTable(void);
+
+    private:
+        MountTable(void);
+
+        void open(void);
+
+        void refreshIfChanged(void);
+        void reload(void);
+
+        std::mutex _mutex;
+        int _fd;
+        bool _loaded;
+        std::vector<MountEntry> _entries;
+        std::unordered_multimap<dev_t, std::size_t> _byDevice;
+    };
+
+    struct SysfsDisk {
+        QString devicePath;  // "/dev/sda"
+        QString syspath;     // "/sys/devices/.../block/sda"
+        QString usbPortPath; // as extractUsbPortPath reports it
+        int vid;             // 0 for non-USB disks
+        int pid;
+    };
+
+    // Whole disks read straight from /sys/class/block, in the order
+    // libudev enumerates them. Directory fds are opened once and every
+    // attribute is read relative to them, no udev context is involved.
+    class SysfsScanner
+    {
+    public:
+        static auto instance(void) -> SysfsScanner&;
+
+        auto disks(void) -> std::vector<SysfsDisk>;
+
+        // sysfs and /dev of the current roots from now on
+        void reopen(void);
+
+        ~SysfsScanner(void);
+
+    private:
+        SysfsScanner(void);
+
+        void open(void);
+        void close(void);
+
+        auto usbIds(QByteArray const& relativeSyspath, QString const& usbPortPath)
+            -> std::pair<int, int>;
+
+        std::mutex _mutex;
+        QString _sysRoot;
+        QString _devRoot;
+        int _sysFd;
+        DIR* _classBlock;
+    };
+
+    // Device number of the block device file, 0 if it is not a block
+    // device. Recorded trees keep plain files in place of device nodes,
+    // their numbers come from sysfs.
+    auto blockDeviceNumber(QString const& devFilePath) -> dev_t;
+
+    // Content of a small sysfs/procfs file without trailing newline,
+    // empty if the file can not be read
+    auto readAttribute(QString const& path) -> QByteArray;
+
+    // "1-1.2" for a sysfs path below USB device 1-1.2,
+    // the path itself when it is not a USB device
+    auto extractUsbPortPath(QString const& devicePath) -> QString;
+
+    // "<sys>/class/block/sda" for "/dev/sda" or any symlink to it
+    auto sysfsBlockDir(QString const& devicePath) -> QString;
+
+    // "E:" properties udev stored for the block device in its database
+    auto udevProperties(dev_t device) -> QHash<QByteArray, QByteArray>;
+
+    // Resolves partition node ("/dev/mmcblk0p1") by its number using
+    // sysfs, falls back to kernel naming rules if sysfs has no entry yet
+    auto partitionNodePath(QString const& diskPath, int number) -> QString;
+}
+
+
+#endif // LINUX_UTILS_H
@@ -0,0 +1,254 @@
+#include "linux_utils.h"
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+
+namespace {
+    // mountinfo escapes ' ', '\t', '\n' and '\\' as octal "\040"
+    auto unescape(QByteArray const& field) {
+        auto result = QByteArray();
+        result.reserve(field.size());
+
+        for (auto i = 0; i < field.size(); i++) {
+            if (field.at(i) == '\\' && i + 3 < field.size()) {
+                auto octal = field.mid(i + 1, 3);
+                auto ok = false;
+                auto ch = octal.toInt(&ok, 8);
+                if (ok && octal.size() == 3) {
+                    result.append(char(ch));
+                    i += 3;
+                    continue;
+                }
+            }
+            result.append(field.at(i));
+        }
+
+        return QString::fromUtf8(result);
+    }
+
+
+    auto parseDeviceNumber(QByteArray const& field) -> dev_t {
+        auto parts = field.split(':');
+        if (parts.size() != 2) {
+            return 0;
+        }
+
+        return makedev(parts.at(0).toUInt(), parts.at(1).toUInt());
+    }
+
+
+    // sysfs keeps partitions as subdirectories of their disk
+    auto diskOf(dev_t device) -> dev_t {
+        auto link = QString("%1/dev/block/%2:%3")
+            .arg(linux_utils::roots().sys).arg(major(device)).arg(minor(device));
+
+        char resolved[PATH_MAX];
+        if (!::realpath(link.toStdString().data(), resolved)) {
+            return device;
+        }
+
+        auto sysfsDir = QDir(QString(resolved));
+        if (!sysfsDir.exists("partition")) {
+            return device;
+        }
+
+        sysfsDir.cdUp();
+        auto disk = parseDeviceNumber(linux_utils::readAttribute(sysfsDir.filePath("dev")));
+        return disk == 0 ? device : disk;
+    }
+
+
+    auto readAll(int fd) -> QByteArray {
+        auto content = QByteArray();
+        char chunk[4096];
+
+        if (::lseek(fd, 0, SEEK_SET) == -1) {
+            return content;
+        }
+
+        for (;;) {
+            auto readed = ::read(fd, chunk, sizeof(chunk));
+            if (readed <= 0) {
+                break;
+            }
+            content.append(chunk, int(readed));
+        }
+
+        return content;
+    }
+}
+
+
+namespace linux_utils {
+    auto MountTable::instance(void) -> MountTable& {
+        static MountTable table;
+        return table;
+    }
+
+
+    MountTable::MountTable(void)
+        : _fd(-1),
+          _loaded(false)
+    {
+        open();
+    }
+
+
+    void MountTable::open(void) {
+        auto path = roots().proc + "/self/mountinfo";
+        _fd = ::open(path.toStdString().data(), O_RDONLY | O_CLOEXEC);
+
+        if (_fd == -1) {
+            auto errnoCache = errno;
+            errnoWarning(__PRETTY_FUNCTION__, "can not open " + path, errnoCache);
+        }
+    }
+
+
+    void MountTable::reopen(void) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_fd != -1) {
+            ::close(_fd);
+        }
+        _entries.clear();
+        _byDevice.clear();
+        _loaded = false;
+
+        open();
+    }
+
+
+    MountTable::~MountTable(void) {
+        if (_fd != -1) {
+            ::close(_fd);
+        }
+    }
+
+
+    auto MountTable::entries(void) -> std::vector<MountEntry> {
+        std::lock_guard<std::mutex> lock(_mutex);
+        refreshIfChanged();
+        return _entries;
+    }
+
+
+    auto MountTable::entriesFor(dev_t device) -> std::vector<MountEntry> {
+        std::lock_guard<std::mutex> lock(_mutex);
+        refreshIfChanged();
+
+        auto indexes = std::vector<std::size_t>();
+        auto range = _byDevice.equal_range(device);
+
+        for (auto it = range.first; it != range.second; ++it) {
+            indexes.push_back(it->second);
+        }
+
+        // multimap order is unspecified, keep mountinfo order
+        std::sort(indexes.begin(), indexes.end());
+
+        auto found = std::vector<MountEntry>();
+        found.reserve(indexes.size());
+        for (auto index : indexes) {
+            found.push_back(_entries.at(index));
+        }
+
+        return found;
+    }
+
+
+    bool MountTable::isMountpoint(QString const& path) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        refreshIfChanged();
+
+        return std::any_of(_entries.cbegin(), _entries.cend(),
+            [&path] (auto const& entry) { return entry.mountpoint == path; }
+        );
+    }
+
+
+    void MountTable::refreshIfChanged(void) {
+        if (_fd == -1) {
+            return;
+        }
+
+        if (_loaded) {
+            ::pollfd pfd = { _fd, POLLPRI, 0 };
+            if (::poll(&pfd, 1, 0) <= 0 || !(pfd.revents & (POLLPRI | POLLERR))) {
+                return;
+            }
+        }
+
+        reload();
+        _loaded = true;
+    }
+
+
+    void MountTable::reload(void) {
+        _entries.clear();
+        _byDevice.clear();
+
+        auto devRoot = roots().dev + '/';
+
+        for (auto const& line : readAll(_fd).split('\n')) {
+            auto fields = line.split(' ');
+            auto separator = fields.indexOf("-");
+
+            // id parent major:minor root mountpoint options [optional...] - fstype source superoptions
+            if (fields.size() < 10 || separator < 6 || separator + 2 >= fields.size()) {
+                continue;
+            }
+
+            auto entry = MountEntry();
+            entry.device = parseDeviceNumber(fields.at(2));
+            entry.mountpoint = unescape(fields.at(4));
+            entry.fsType = unescape(fields.at(separator + 1));
+            entry.source = unescape(fields.at(separator + 2));
+
+            // btrfs and friends report an anonymous device here
+            if (entry.source.startsWith(devRoot)) {
+                auto sourceDevice = blockDeviceNumber(entry.source);
+                if (sourceDevice != 0) {
+                    entry.device = sourceDevice;
+                }
+            }
+
+            entry.disk = major(entry.device) == 0 ? entry.device : diskOf(entry.device);
+
+            auto index = _entries.size();
+            _entries.push_back(entry);
+            _byDevice.emplace(entry.device, index);
+
+            if (entry.disk != entry.device) {
+                _byDevice.emplace(entry.disk, index);
+            }
+        }
+    }
+
+
+    auto blockDeviceNumber(QString const& devFilePath) -> dev_t {
+        struct stat info;
+        if (::stat(devFilePath.toStdString().data(), &info) != 0) {
+            return 0;
+        }
+
+        if (S_ISBLK(info.st_mode)) {
+            return info.st_rdev;
+        }
+
+        // recorded trees only: a file under the live /dev is not a device
+        auto devRoot = roots().dev;
+        if (S_ISREG(info.st_mode) && devRoot != "/dev" && devFilePath.startsWith(devRoot + '/')) {
+            return parseDeviceNumber(readAttribute(sysfsBlockDir(devFilePath) + "/dev"));
+        }
+
+        return 0;
+    }
+}
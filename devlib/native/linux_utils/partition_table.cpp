@@ -0,0 +1,356 @@
+#include "linux_utils.h"
+#include "../crc32.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+
+namespace {
+    constexpr auto Mbr_entriesOffset = 446;
+    constexpr auto Mbr_entrySize = 16;
+    constexpr auto Mbr_primaryEntries = 4;
+    constexpr auto Mbr_firstLogicalNumber = 5;
+    constexpr auto Mbr_maxLogicalPartitions = 128;
+
+    constexpr auto Mbr_statusInactive = 0x00;
+    constexpr auto Mbr_statusActive = 0x80;
+
+    constexpr auto Gpt_protectiveType = 0xEE;
+    constexpr char Gpt_signature[] = "EFI PART";
+    constexpr auto Gpt_minEntrySize = 128;
+    constexpr auto Gpt_maxEntriesBytes = 1024 * 1024;
+    constexpr auto Gpt_nameLength = 36;
+
+
+    template<typename T>
+    auto le(QByteArray const& buffer, int offset) {
+        return qFromLittleEndian<T>(
+            reinterpret_cast<uchar const*>(buffer.constData()) + offset
+        );
+    }
+
+
+    auto readAt(int fd, qint64 offset, int size) -> QByteArray {
+        auto buffer = QByteArray(size, '\0');
+        auto readed = ::pread(fd, buffer.data(), size, offset);
+
+        if (readed != size) {
+            auto errnoCache = errno;
+            linux_utils::errnoWarning(__PRETTY_FUNCTION__,
+                QString("can not read %1 bytes at %2").arg(size).arg(offset),
+                errnoCache);
+            return {};
+        }
+
+        return buffer;
+    }
+
+
+    // GPT stores first three GUID fields little-endian
+    auto guidToString(QByteArray const& buffer, int offset) {
+        auto bytes = reinterpret_cast<uchar const*>(buffer.constData()) + offset;
+
+        return QString("%1-%2-%3-%4-%5")
+            .arg(le<quint32>(buffer, offset), 8, 16, QChar('0'))
+            .arg(le<quint16>(buffer, offset + 4), 4, 16, QChar('0'))
+            .arg(le<quint16>(buffer, offset + 6), 4, 16, QChar('0'))
+            .arg(QString(QByteArray(reinterpret_cast<char const*>(bytes + 8), 2).toHex()))
+            .arg(QString(QByteArray(reinterpret_cast<char const*>(bytes + 10), 6).toHex()));
+    }
+
+
+    auto isZeroGuid(QByteArray const& buffer, int offset) {
+        auto begin = buffer.constData() + offset;
+        return std::all_of(begin, begin + 16, [] (char byte) { return byte == 0; });
+    }
+
+
+    auto gptName(QByteArray const& buffer, int offset) {
+        auto name = QString();
+        for (auto i = 0; i < Gpt_nameLength; i++) {
+            auto ch = le<quint16>(buffer, offset + i * 2);
+            if (ch == 0) {
+                break;
+            }
+            name.append(QChar(ch));
+        }
+        return name;
+    }
+
+
+    auto isExtendedType(int type) {
+        return type == 0x05 || type == 0x0F || type == 0x85;
+    }
+
+
+    auto mbrUuid(quint32 diskSignature, int number) {
+        return QString("%1-%2")
+            .arg(diskSignature, 8, 16, QChar('0'))
+            .arg(number, 2, 16, QChar('0'));
+    }
+
+
+    // FAT, exFAT and NTFS boot sectors end with 0x55AA too: a jump over
+    // the BPB, then the OEM ID (exFAT, NTFS) or the FAT type string of
+    // the FAT12/16 or FAT32 BPB
+    auto isVolumeBootSector(QByteArray const& sector) {
+        auto jump = uchar(sector.at(0));
+        if (!(jump == 0xEB && uchar(sector.at(2)) == 0x90) && jump != 0xE9) {
+            return false;
+        }
+
+        auto oemId = sector.mid(3, 8);
+        return oemId.startsWith("NTFS") || oemId.startsWith("EXFAT")
+            || sector.mid(54, 3) == "FAT" || sector.mid(82, 3) == "FAT";
+    }
+
+
+    struct LbaRange {
+        qint64 first;
+        qint64 end; // past the last sector
+    };
+
+
+    auto overlaps(LbaRange const& left, LbaRange const& right) {
+        return left.first < right.end && right.first < left.end;
+    }
+
+
+    // Status bytes other than 0x00/0x80, overlapping entries or ones past
+    // the end of the disk mean the sector is not a partition table.
+    // `diskSectors` is 0 when the size is unknown.
+    auto hasValidMbrEntries(QByteArray const& sector, qint64 diskSectors) {
+        auto ranges = std::vector<LbaRange>();
+
+        for (auto i = 0; i < Mbr_primaryEntries; i++) {
+            auto offset = Mbr_entriesOffset + i * Mbr_entrySize;
+            auto status = uchar(sector.at(offset));
+            auto type = uchar(sector.at(offset + 4));
+
+            if (status != Mbr_statusInactive && status != Mbr_statusActive) {
+                return false;
+            }
+
+            // protective entry covers the disk, or 0xFFFFFFFF sectors
+            if (type == 0 || type == Gpt_protectiveType) {
+                continue;
+            }
+
+            auto first = qint64(le<quint32>(sector, offset + 8));
+            auto range = LbaRange { first, first + le<quint32>(sector, offset + 12) };
+
+            if (range.end == range.first || (diskSectors > 0 && range.end > diskSectors)) {
+                return false;
+            }
+
+            auto overlapping = std::any_of(ranges.cbegin(), ranges.cend(),
+                [&range] (LbaRange const& other) { return overlaps(range, other); }
+            );
+            if (overlapping) {
+                return false;
+            }
+
+            ranges.push_back(range);
+        }
+
+        return true;
+    }
+
+
+    auto parseGpt(int fd, int sectorSize, qint64 diskSectors, QByteArray const& header)
+        -> std::vector<linux_utils::PartitionTableEntry>
+    {
+        auto partitions = std::vector<linux_utils::PartitionTableEntry>();
+
+        if (!header.startsWith(Gpt_signature)) {
+            linux_utils::warning(__PRETTY_FUNCTION__, "no GPT header signature");
+            return partitions;
+        }
+
+        auto headerSize = le<quint32>(header, 12);
+
+        if (headerSize < 92 || int(headerSize) > header.size()) {
+            linux_utils::warning(__PRETTY_FUNCTION__, "invalid GPT header size");
+            return partitions;
+        }
+
+        auto headerCopy = header.left(headerSize);
+        std::memset(headerCopy.data() + 16, 0, 4);
+
+        if (devlib::native::crc32(headerCopy.constData(), headerSize)
+                != le<quint32>(header, 16)) {
+            linux_utils::warning(__PRETTY_FUNCTION__, "GPT header checksum mismatch");
+            return partitions;
+        }
+
+        auto entriesLba = le<quint64>(header, 72);
+        auto entriesCount = le<quint32>(header, 80);
+        auto entrySize = le<quint32>(header, 84);
+        auto entriesBytes = qint64(entriesCount) * entrySize;
+
+        if (entrySize < Gpt_minEntrySize || entriesBytes > Gpt_maxEntriesBytes) {
+            linux_utils::warning(__PRETTY_FUNCTION__, "invalid GPT entries array");
+            return partitions;
+        }
+
+        auto alignedBytes = (entriesBytes + sectorSize - 1) / sectorSize * sectorSize;
+        auto entries = readAt(fd, qint64(entriesLba) * sectorSize, int(alignedBytes));
+
+        if (entries.isEmpty()) {
+            return partitions;
+        }
+
+        if (devlib::native::crc32(entries.constData(), entriesBytes)
+                != le<quint32>(header, 88)) {
+            linux_utils::warning(__PRETTY_FUNCTION__, "GPT entries checksum mismatch");
+            return partitions;
+        }
+
+        for (auto i = 0u; i < entriesCount; i++) {
+            auto offset = int(i * entrySize);
+            if (isZeroGuid(entries, offset)) {
+                continue;
+            }
+
+            auto firstLba = le<quint64>(entries, offset + 32);
+            auto lastLba  = le<quint64>(entries, offset + 40);
+
+            if (lastLba < firstLba || (diskSectors > 0 && lastLba >= quint64(diskSectors))) {
+                linux_utils::warning(__PRETTY_FUNCTION__, "GPT entry out of the disk");
+                return {};
+            }
+
+            auto entry = linux_utils::PartitionTableEntry();
+            entry.number = int(i) + 1;
+            entry.start = qint64(firstLba) * sectorSize;
+            entry.size = qint64(lastLba - firstLba + 1) * sectorSize;
+            entry.typeId = guidToString(entries, offset);
+            entry.uuid = guidToString(entries, offset + 16);
+            entry.name = gptName(entries, offset + 56);
+
+            partitions.push_back(entry);
+        }
+
+        return partitions;
+    }
+
+
+    auto makeMbrEntry(QByteArray const& sector, int index,
+                      qint64 baseLba, int sectorSize)
+    {
+        auto offset = Mbr_entriesOffset + index * Mbr_entrySize;
+
+        auto entry = linux_utils::PartitionTableEntry();
+        entry.start = (baseLba + le<quint32>(sector, offset + 8)) * sectorSize;
+        entry.size = qint64(le<quint32>(sector, offset + 12)) * sectorSize;
+        entry.typeId = QString("0x%1").arg(int(uchar(sector.at(offset + 4))), 2, 16, QChar('0'));
+
+        return entry;
+    }
+
+
+    // logical partitions live in a chain of EBRs inside the extended one
+    void appendLogicalPartitions(int fd, int sectorSize, LbaRange const& extended,
+                                 quint32 diskSignature,
+                                 std::vector<linux_utils::PartitionTableEntry>& partitions)
+    {
+        auto extendedLba = extended.first;
+        auto ebrLba = extendedLba;
+        auto number = Mbr_firstLogicalNumber;
+        auto previousEnd = extendedLba;
+
+        // bounded, a broken chain may point back to itself
+        for (auto hops = 0; hops < Mbr_maxLogicalPartitions; hops++) {
+            auto ebr = readAt(fd, ebrLba * sectorSize, sectorSize);
+            if (ebr.isEmpty() || le<quint16>(ebr, 510) != 0xAA55) {
+                return;
+            }
+
+            auto logical = makeMbrEntry(ebr, 0, ebrLba, sectorSize);
+            auto range = LbaRange { logical.start / sectorSize,
+                                    (logical.start + logical.size) / sectorSize };
+
+            // each one follows its EBR, within the extended partition
+            if (logical.size > 0 && (range.first < previousEnd || range.end > extended.end)) {
+                linux_utils::warning(__PRETTY_FUNCTION__, "logical partition out of the extended one");
+                return;
+            }
+
+            if (logical.size > 0) {
+                previousEnd = range.end;
+                logical.number = number;
+                logical.uuid = mbrUuid(diskSignature, number);
+                partitions.push_back(logical);
+                number++;
+            }
+
+            auto nextOffset = le<quint32>(ebr, Mbr_entriesOffset + Mbr_entrySize + 8);
+            if (nextOffset == 0) {
+                return;
+            }
+            ebrLba = extendedLba + nextOffset;
+        }
+    }
+}
+
+
+namespace linux_utils {
+    auto readPartitionTable(int fd, int sectorSize)
+        -> std::vector<PartitionTableEntry>
+    {
+        auto partitions = std::vector<PartitionTableEntry>();
+
+        // LBA 0 (MBR) and LBA 1 (GPT header) at once
+        auto head = readAt(fd, 0, sectorSize * 2);
+        if (head.isEmpty() || le<quint16>(head, 510) != 0xAA55) {
+            return partitions;
+        }
+
+        // "superfloppy": the whole disk is one filesystem
+        if (isVolumeBootSector(head)) {
+            return partitions;
+        }
+
+        auto diskSectors = deviceSize(fd) / sectorSize;
+        if (!hasValidMbrEntries(head, diskSectors)) {
+            warning(__PRETTY_FUNCTION__, "invalid MBR partition entries");
+            return partitions;
+        }
+
+        auto diskSignature = le<quint32>(head, 440);
+        auto extended = LbaRange { 0, 0 };
+
+        for (auto i = 0; i < Mbr_primaryEntries; i++) {
+            auto offset = Mbr_entriesOffset + i * Mbr_entrySize;
+            auto type = uchar(head.at(offset + 4));
+
+            if (type == Gpt_protectiveType) {
+                return parseGpt(fd, sectorSize, diskSectors, head.mid(sectorSize));
+            }
+
+            if (type == 0) {
+                continue;
+            }
+
+            auto entry = makeMbrEntry(head, i, 0, sectorSize);
+            entry.number = i + 1;
+            entry.uuid = mbrUuid(diskSignature, entry.number);
+            partitions.push_back(entry);
+
+            if (isExtendedType(type)) {
+                extended.first = entry.start / sectorSize;
+                extended.end = (entry.start + entry.size) / sectorSize;
+            }
+        }
+
+        if (extended.first != 0) {
+            appendLogicalPartitions(fd, sectorSize, extended,
+                                    diskSignature, partitions);
+        }
+
+        return partitions;
+    }
+}
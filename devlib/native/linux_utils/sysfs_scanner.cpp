@@ -0,0 +1,207 @@
+#include "linux_utils.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+
+
+namespace {
+    // Small sysfs attribute relative to `dirFd`, trimmed
+    auto readAt(int dirFd, QByteArray const& path) -> QByteArray {
+        auto fd = ::openat(dirFd, path.constData(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return {};
+        }
+
+        char buffer[4096];
+        auto content = QByteArray();
+
+        for (;;) {
+            auto count = ::read(fd, buffer, sizeof(buffer));
+            if (count <= 0) {
+                break;
+            }
+            content.append(buffer, static_cast<int>(count));
+        }
+
+        ::close(fd);
+        return content.trimmed();
+    }
+
+
+    auto ueventValue(QByteArray const& uevent, QByteArray const& key) -> QByteArray {
+        for (auto const& line : uevent.split('\n')) {
+            if (line.startsWith(key) && line.size() > key.size()
+                    && line.at(key.size()) == '=') {
+                return line.mid(key.size() + 1);
+            }
+        }
+
+        return {};
+    }
+
+
+    // libudev lists devices sorted by syspath, but moves md and dm
+    // devices to the end, since they are stacked on top of the others
+    bool delayedByUdev(QString const& syspath) {
+        return syspath.contains("/block/md") || syspath.contains("/block/dm-");
+    }
+}
+
+
+namespace linux_utils {
+    auto SysfsScanner::instance(void) -> SysfsScanner& {
+        static SysfsScanner scanner;
+        return scanner;
+    }
+
+
+    SysfsScanner::SysfsScanner(void)
+        : _sysFd(-1),
+          _classBlock(nullptr)
+    {
+        open();
+    }
+
+
+    SysfsScanner::~SysfsScanner(void) {
+        close();
+    }
+
+
+    void SysfsScanner::reopen(void) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        close();
+        open();
+    }
+
+
+    void SysfsScanner::open(void) {
+        auto const current = roots();
+        _sysRoot = current.sys;
+        _devRoot = current.dev;
+
+        _sysFd = ::open(_sysRoot.toStdString().data(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (_sysFd == -1) {
+            auto errnoCache = errno;
+            errnoWarning(__PRETTY_FUNCTION__, "can not open " + _sysRoot, errnoCache);
+            return;
+        }
+
+        auto classFd = ::openat(_sysFd, "class/block", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        _classBlock = classFd != -1 ? ::fdopendir(classFd) : nullptr;
+
+        if (_classBlock == nullptr) {
+            auto errnoCache = errno;
+            errnoWarning(__PRETTY_FUNCTION__, "can not open " + _sysRoot + "/class/block", errnoCache);
+
+            if (classFd != -1) {
+                ::close(classFd);
+            }
+        }
+    }
+
+
+    void SysfsScanner::close(void) {
+        if (_classBlock) {
+            ::closedir(_classBlock);
+            _classBlock = nullptr;
+        }
+
+        if (_sysFd != -1) {
+            ::close(_sysFd);
+            _sysFd = -1;
+        }
+    }
+
+
+    auto SysfsScanner::disks(void) -> std::vector<SysfsDisk> {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto disks = std::vector<SysfsDisk>();
+
+        if (_classBlock == nullptr) {
+            return disks;
+        }
+
+        ::rewinddir(_classBlock);
+        auto classFd = ::dirfd(_classBlock);
+
+        while (auto entry = ::readdir(_classBlock)) {
+            auto name = QByteArray(entry->d_name);
+            if (name.startsWith('.')) {
+                continue;
+            }
+
+            // only partitions have this attribute
+            if (::faccessat(classFd, (name + "/partition").constData(), F_OK, 0) == 0) {
+                continue;
+            }
+
+            // "../../devices/pci0000:00/.../block/sda"
+            char target[PATH_MAX];
+            auto length = ::readlinkat(classFd, name.constData(), target, sizeof(target));
+            if (length <= 0 || static_cast<std::size_t>(length) == sizeof(target)) {
+                continue;
+            }
+
+            auto relative = QByteArray(target, static_cast<int>(length));
+            while (relative.startsWith("../")) {
+                relative.remove(0, 3);
+            }
+
+            auto devName = ueventValue(readAt(classFd, name + "/uevent"), "DEVNAME");
+
+            auto disk = SysfsDisk();
+            disk.syspath = QString(_sysRoot + '/').append(QString::fromLocal8Bit(relative));
+            disk.devicePath = QString(_devRoot + '/').append(
+                QString::fromLocal8Bit(devName.isEmpty() ? name : devName)
+            );
+            disk.usbPortPath = extractUsbPortPath(disk.syspath);
+
+            auto ids = usbIds(relative, disk.usbPortPath);
+            disk.vid = ids.first;
+            disk.pid = ids.second;
+
+            disks.push_back(disk);
+        }
+
+        std::sort(disks.begin(), disks.end(),
+            [] (SysfsDisk const& left, SysfsDisk const& right) {
+                auto leftDelayed = delayedByUdev(left.syspath);
+                auto rightDelayed = delayedByUdev(right.syspath);
+
+                if (leftDelayed != rightDelayed) {
+                    return rightDelayed;
+                }
+                return left.syspath < right.syspath;
+            }
+        );
+
+        return disks;
+    }
+
+
+    auto SysfsScanner::usbIds(QByteArray const& relativeSyspath,
+                              QString const& usbPortPath) -> std::pair<int, int>
+    {
+        // attributes of the USB device the disk is below,
+        // ".../usb1/1-1/1-1.2/" for port path "1-1.2"
+        auto marker = QByteArray("/").append(usbPortPath.toLatin1()).append('/');
+        auto position = relativeSyspath.indexOf(marker);
+
+        if (position == -1) {
+            return { 0, 0 };
+        }
+
+        auto usbDevice = relativeSyspath.left(position + marker.size());
+
+        auto base = 16;
+        return std::make_pair(
+            readAt(_sysFd, usbDevice + "idVendor").toInt(nullptr, base),
+            readAt(_sysFd, usbDevice + "idProduct").toInt(nullptr, base)
+        );
+    }
+}
@@ -7,7 +7,7 @@
 
 
 auto devlib::native::devicePartitions(QString const& devicePath)
-    -> std::vector<std::tuple<QString, QString>>
+    -> std::vector<PartitionInfo>
 {
     Q_ASSERT(!devicePath.isEmpty());
     auto deviceName = devicePath.split('/').last();
@@ -24,9 +24,7 @@ auto devlib::native::devicePartitions(QString const& devicePath)
                                           << diskutil.readAllStandardError();
     }
 
-    auto devicePartitionnsList = std::vector<
-        std::tuple<QString, QString>
-    >();
+    auto devicePartitionnsList = std::vector<PartitionInfo>();
 
     QDomDocument domDocument;
 
@@ -60,7 +58,7 @@ auto devlib::native::devicePartitions(QString const& devicePath)
         auto partitionDict = partitions.at(i).toElement();
         auto partDictChilds = partitionDict.childNodes();
 
-        QString partName, partLabel;
+        QString partName, partLabel, partContent, partUuid;
 
         for (auto j = 0; j < partDictChilds.count(); j++) {
             auto child = partDictChilds.at(j).toElement();
@@ -69,24 +67,50 @@ auto devlib::native::devicePartitions(QString const& devicePath)
                 [&partName]  (auto const& value) { partName = value; });
             macos_utils::extractValueByKey(child, "VolumeName",
                 [&partLabel] (auto const& value) { partLabel = value; });
+            macos_utils::extractValueByKey(child, "Content",
+                [&partContent] (auto const& value) { partContent = value; });
+            macos_utils::extractValueByKey(child, "DiskUUID",
+                [&partUuid] (auto const& value) { partUuid = value; });
         }
 
         qCDebug(macos_utils::macxlog()) << "Found partition with "
                                         << "Name: " << partName
                                         << "Label: " << partLabel;
 
-        devicePartitionnsList.push_back(
-            std::make_tuple(partName.prepend("/dev/"), partLabel)
-        );
+        auto partition = PartitionInfo();
+        partition.filePath = partName.prepend("/dev/");
+        partition.label = partLabel;
+        partition.typeId = partContent;
+        partition.uuid = partUuid;
+
+        devicePartitionnsList.push_back(partition);
     }
 
     return devicePartitionnsList;
 }
 
 
-auto devlib::native::requestUsbDeviceList(void)
+// Temporarily unsupported
+void devlib::native::setSystemRoots(SystemRoots const& roots)
+{
+    Q_UNUSED(roots);
+}
+
+
+// Temporarily unsupported
+auto devlib::native::systemRoots(void)
+    -> SystemRoots
+{
+    return SystemRoots();
+}
+
+
+auto devlib::native::requestUsbDeviceList(DiscoveryBackend backend)
     -> std::vector<std::tuple<int, int, QString, QString>>
 {
+    // there is no sysfs, every backend means IOKit
+    Q_UNUSED(backend);
+
     std::vector<std::tuple<int, int, QString, QString>> devlist;
 
     mach_port_t masterPort;
@@ -163,17 +187,26 @@ auto devlib::native::umountPartition(QString const& mntpt)
 }
 
 
-bool devlib::native::umountDisk(QString const & devicePath)
+auto devlib::native::umountDisk(QString const& devicePath,
+                                std::chrono::milliseconds deadline,
+                                bool lazyDetach) -> UmountReport
 {
+    Q_UNUSED(deadline); Q_UNUSED(lazyDetach);
+
     auto unmountResult = macos_utils::unmountDiskWithRunLoop(devicePath.toStdString().data());
-    return unmountResult == macos_utils::UnmountResult::Success;
+    auto status = unmountResult == macos_utils::UnmountResult::Success ?
+        UmountStatus::Unmounted : UmountStatus::NotHandled;
+
+    return { status, {}, {} };
 }
 
 
-bool devlib::native::mount(const QString &dev, const QString &path)
+bool devlib::native::mount(const QString &dev, const QString &path, const QString &fsType)
 {
+    Q_UNUSED(fsType);
+
     QProcess mount;
-    mount.start(QString("mount -t msdos %1 %2").arg(dev).arg(path));
+    mount.start("mount", { "-t", "msdos", dev, path });
     mount.waitForFinished();
     return mount.exitCode() == 0;
 }
@@ -195,6 +228,13 @@ auto devlib::native::mntptsForPartition(QString const& devFilePath)
 }
 
 
+bool devlib::native::isMountpoint(QString const& mntpt)
+{
+    auto info = QStorageInfo(mntpt);
+    return info.isValid() && info.rootPath() == mntpt;
+}
+
+
 auto devlib::native::mntptsList(void)
     -> std::vector<QString>
 {
@@ -209,6 +249,118 @@ auto devlib::native::mntptsList(void)
 }
 
 
+// Temporarily unsupported
+auto devlib::native::deviceAttributes(QString const& devicePath)
+    -> DeviceAttributes
+{
+    Q_UNUSED(devicePath);
+    return {};
+}
+
+
+// Temporarily unsupported
+auto devlib::native::makeChangeMonitor(void)
+    -> std::unique_ptr<ChangeMonitor>
+{
+    return nullptr;
+}
+
+
+auto devlib::native::pollChanges(ChangeMonitor* monitor)
+    -> std::vector<ChangeEvent>
+{
+    Q_UNUSED(monitor);
+    return {};
+}
+
+
+// Temporarily unsupported
+auto devlib::native::serveLocalSocket(QString const& path,
+                                      std::function<QByteArray(QByteArray const&)> respond)
+    -> std::unique_ptr<LocalServer>
+{
+    Q_UNUSED(path); Q_UNUSED(respond);
+    return nullptr;
+}
+
+
+// Temporarily unsupported
+auto devlib::native::affinity::nodeCpus(int node)
+    -> std::vector<int>
+{
+    Q_UNUSED(node);
+    return {};
+}
+
+
+// Temporarily unsupported
+auto devlib::native::affinity::cpuNode(int cpu)
+    -> int
+{
+    Q_UNUSED(cpu);
+    return -1;
+}
+
+
+// Temporarily unsupported
+auto devlib::native::affinity::deviceNode(QString const& devicePath)
+    -> int
+{
+    Q_UNUSED(devicePath);
+    return -1;
+}
+
+
+// Temporarily unsupported
+bool devlib::native::affinity::pinCurrentThread(std::vector<int> const& cpus)
+{
+    Q_UNUSED(cpus);
+    return false;
+}
+
+
+// Temporarily unsupported
+auto devlib::native::affinity::currentThreadCpus(void)
+    -> std::vector<int>
+{
+    return {};
+}
+
+
+// Temporarily unsupported
+auto devlib::native::affinity::currentCpu(void)
+    -> int
+{
+    return -1;
+}
+
+
+// Temporarily unsupported
+bool devlib::native::affinity::preferNode(void* data, qint64 size, int node)
+{
+    Q_UNUSED(data); Q_UNUSED(size); Q_UNUSED(node);
+    return false;
+}
+
+
+// Temporarily unsupported
+auto devlib::native::memory::map(qint64 size, Pages pages, int node,
+                                 bool prefault, bool lock)
+    -> Mapping
+{
+    Q_UNUSED(size); Q_UNUSED(pages); Q_UNUSED(node);
+    Q_UNUSED(prefault); Q_UNUSED(lock);
+    return Mapping();
+}
+
+
+// Temporarily unsupported
+void devlib::native::memory::unmap(Mapping const& mapping)
+{
+    Q_UNUSED(mapping);
+}
+
+
 auto devlib::native::io::read(FileHandle* handle, char *data, qint64 sz)
     -> qint64
 {
@@ -313,6 +465,65 @@ auto devlib::native::io::authOpen(char const* filename)
 }
 
 
+auto devlib::native::io::openDirect(char const* filename, bool exclusive)
+    -> std::unique_ptr<FileHandle>
+{
+    // the unmounted disk is left to DiskArbitration
+    Q_UNUSED(exclusive);
+
+    if (!macos_utils::isDiskName(filename)) {
+        qCWarning(macos_utils::macxlog()) << filename << " is not diskname";
+        return {};
+    }
+
+    auto rawDiskName = macos_utils::convertToRawDiskName(filename);
+
+    auto fd = ::open(rawDiskName.toStdString().data(), O_RDONLY);
+    if (fd < 0) {
+        qCWarning(macos_utils::macxlog()) << "open(2) :" << strerror(errno);
+        return {};
+    }
+
+    if (::fcntl(fd, F_NOCACHE, 1)) {
+        qCWarning(macos_utils::macxlog()) << "can not disable buffering";
+    }
+
+    return macos_utils::makeHandle(fd);
+}
+
+
+auto devlib::native::io::readAt(FileHandle* handle, char* data, qint64 sz, qint64 pos)
+    -> qint64
+{
+    Q_ASSERT(handle);
+    auto macxHandle = macos_utils::asMacxFileHandle(handle);
+
+    auto readed = ::pread(macxHandle->fd, data, sz, pos);
+    if (readed == -1) {
+        qCWarning(macos_utils::macxlog()) << "Can not read from file:"
+                                          << ::strerror(errno);
+    }
+
+    return readed;
+}
+
+
+auto devlib::native::io::writeAt(FileHandle* handle, char const* data, qint64 sz, qint64 pos)
+    -> qint64
+{
+    Q_ASSERT(handle);
+    auto macxHandle = macos_utils::asMacxFileHandle(handle);
+
+    auto written = ::pwrite(macxHandle->fd, data, sz, pos);
+    if (written == -1) {
+        qCWarning(macos_utils::macxlog()) << "Can not write to file:"
+                                          << ::strerror(errno);
+    }
+
+    return written;
+}
+
+
 bool devlib::native::io::seek(FileHandle* handle, qint64 pos)
 {
     Q_ASSERT(handle);
@@ -321,5 +532,13 @@ bool devlib::native::io::seek(FileHandle* handle, qint64 pos)
 }
 
 
-void devlib::native::io::sync(FileHandle* handle)
-{ Q_UNUSED(handle); /* temporary stub */ }
+// Temporarily unsupported
+bool devlib::native::io::zeroRange(FileHandle* handle, qint64 pos, qint64 size)
+{
+    Q_UNUSED(handle); Q_UNUSED(pos); Q_UNUSED(size);
+    return false;
+}
+
+
+bool devlib::native::io::sync(FileHandle* handle)
+{ Q_UNUSED(handle); /* temporary stub */ return true; }
@@ -3,6 +3,8 @@
 
 #include <QtCore>
 
+#include <chrono>
+#include <functional>
 #include <tuple>
 #include <memory>
 #include <vector>
@@ -17,20 +19,171 @@ namespace devlib {
         auto umountPartition(QString const& mntpt)
             -> std::unique_ptr<LockHandle>;
 
-        bool umountDisk(QString const & devicePath);
+        enum class UmountStatus {
+            Unmounted,  // nothing of the disk is mounted anymore
+            Busy,       // some mountpoints are still in use
+            NotHandled  // unmount mountpoints one by one instead
+        };
+
+        struct UmountReport {
+            UmountStatus status;
+            std::vector<QString> busyMountpoints;
+            std::vector<QString> detachedMountpoints;
+        };
 
-        bool mount(QString const& dev, QString const& path);
+        // Unmounts everything mounted from the disk and its partitions.
+        // Mountpoints still busy at `deadline` are lazily detached
+        // when `lazyDetach` is set, otherwise reported as busy.
+        auto umountDisk(QString const& devicePath,
+                        std::chrono::milliseconds deadline,
+                        bool lazyDetach) -> UmountReport;
+
+        // `fsType` as blkid reports it; probed from `dev` when empty
+        bool mount(QString const& dev, QString const& path, QString const& fsType);
 
         auto mntptsList(void) -> std::vector<QString>;
 
+        bool isMountpoint(QString const& mntpt);
+
         auto mntptsForPartition(QString const& devFilePath)
             -> std::vector<std::pair<QString, QString>>;
 
-        auto requestUsbDeviceList(void)
+        // Platform: udev on Linux, SetupAPI on Windows, IOKit on macOS.
+        // Sysfs: /sys/class/block read directly, Linux only; reports
+        // the same devices as udev does
+        enum class DiscoveryBackend { Platform, Sysfs };
+
+        // Where the system is looked up. Benchmarks point these at
+        // recorded trees; libudev (the Platform backend), the change
+        // monitor and the CPU topology always use the live system.
+        // Linux only.
+        struct SystemRoots {
+            QString sys = "/sys";
+            QString dev = "/dev";
+            QString proc = "/proc";
+            QString udev = "/run/udev";
+        };
+
+        void setSystemRoots(SystemRoots const& roots);
+        auto systemRoots(void) -> SystemRoots;
+
+        auto requestUsbDeviceList(DiscoveryBackend backend = DiscoveryBackend::Platform)
             -> std::vector<std::tuple<int, int, QString, QString>>;
 
+        struct PartitionInfo {
+            QString filePath;
+            QString label;   // filesystem label
+            QString fsType;  // filesystem type, e.g. "vfat"
+            QString typeId;  // GPT type GUID or MBR type as "0x0c"
+            QString uuid;    // PARTUUID
+            QString name;    // GPT partition name
+            qint64 start = 0;
+            qint64 size = 0;
+        };
+
         auto devicePartitions(QString const& deviceName)
-            -> std::vector<std::tuple<QString, QString>>;
+            -> std::vector<PartitionInfo>;
+
+        struct DeviceAttributes {
+            qint64 capacity = 0; // bytes
+            QString serial;
+            QString vendorName;
+            QString model;
+            bool removable = false;
+            bool readOnly = false;
+        };
+
+        // Does not open the device itself
+        auto deviceAttributes(QString const& devicePath)
+            -> DeviceAttributes;
+
+        enum class ChangeKind {
+            Device,     // whole disk appeared, disappeared or changed
+            Partition,  // partition of `parentPath` disk appeared or disappeared
+            MountTable  // something was mounted or unmounted
+        };
+
+        struct ChangeEvent {
+            ChangeKind kind;
+            QString action;
+            QString devicePath;
+            QString parentPath;
+
+            // filled for Device events, as requestUsbDeviceList reports them
+            int vid = 0;
+            int pid = 0;
+            QString usbPortPath;
+        };
+
+        struct ChangeMonitor {
+            virtual ~ChangeMonitor() = default;
+        };
+
+        // Returns nullptr when the platform can not report changes,
+        // callers have to re-query everything in that case.
+        auto makeChangeMonitor(void)
+            -> std::unique_ptr<ChangeMonitor>;
+
+        // Non-blocking, returns events received since the previous call
+        auto pollChanges(ChangeMonitor* monitor)
+            -> std::vector<ChangeEvent>;
+
+        struct LocalServer {
+            virtual ~LocalServer() = default;
+        };
+
+        // Unix domain socket at `path` answering every connection with
+        // respond(what the client sent first) and closing it, from a
+        // thread of its own until the server is destroyed. A stale socket
+        // left at `path` is replaced. nullptr if it can not be bound.
+        // Linux only.
+        auto serveLocalSocket(QString const& path,
+                              std::function<QByteArray(QByteArray const&)> respond)
+            -> std::unique_ptr<LocalServer>;
+
+        // CPU and NUMA placement of the calling thread. Linux only,
+        // elsewhere nothing is known and nothing gets pinned.
+        namespace affinity {
+            // CPUs of NUMA node `node`, empty if there is no such node
+            auto nodeCpus(int node) -> std::vector<int>;
+
+            // -1 if unknown or the machine is not NUMA
+            auto cpuNode(int cpu) -> int;
+
+            // node the device's host controller is attached to, -1 if unknown
+            auto deviceNode(QString const& devicePath) -> int;
+
+            bool pinCurrentThread(std::vector<int> const& cpus);
+            auto currentThreadCpus(void) -> std::vector<int>;
+
+            // CPU the calling thread runs on right now, -1 if unknown
+            auto currentCpu(void) -> int;
+
+            // Pages of [data, data + size) not yet touched are allocated
+            // on `node`; touched ones are moved there. `data` is page aligned.
+            bool preferNode(void* data, qint64 size, int node);
+        }
+
+        // Anonymous mappings for large I/O buffers. Linux only,
+        // elsewhere map() fails and callers take the heap.
+        namespace memory {
+            enum class Pages { Normal, Transparent, Huge };
+
+            struct Mapping {
+                char* data = nullptr;       // nullptr if nothing was mapped
+                qint64 size = 0;            // whole mapping, `size` rounded up
+                Pages pages = Pages::Normal;
+                bool locked = false;
+            };
+
+            // Page aligned, zero filled. Huge falls back to Transparent
+            // and that to Normal; `node` >= 0 binds the pages there before
+            // `prefault` touches them. A refused `lock` is not a failure.
+            auto map(qint64 size, Pages pages, int node, bool prefault, bool lock)
+                -> Mapping;
+
+            void unmap(Mapping const& mapping);
+        }
 
         namespace io {
             struct FileHandle {
@@ -46,9 +199,31 @@ namespace devlib {
             auto authOpen(char const * filename)
                 -> std::unique_ptr<FileHandle>;
 
+            // Read-only handle that bypasses the page cache. Buffers, sizes
+            // and offsets passed to readAt() must be sector aligned.
+            // `exclusive` fails on a mounted or otherwise claimed device
+            // and keeps it from being mounted meanwhile. On Linux it does
+            // not stop plain writers, only mounts and other exclusive
+            // opens; unmount the device to keep it from changing.
+            auto openDirect(char const* filename, bool exclusive = false)
+                -> std::unique_ptr<FileHandle>;
+
+            // pread(2)-like, does not move the file position and may be
+            // called from several threads on the same handle
+            auto readAt(FileHandle* handle, char* data, qint64 sz, qint64 pos) -> qint64;
+
+            // pwrite(2)-like counterpart of readAt()
+            auto writeAt(FileHandle* handle, char const* data, qint64 sz, qint64 pos) -> qint64;
+
             bool seek(FileHandle*, qint64 pos);
 
-            void sync(FileHandle* handle);
+            // Zeroes [pos, pos + size) without sending the data (BLKZEROOUT
+            // on block devices). False if the device can not do it, the
+            // range has to be written then. File position is unspecified.
+            bool zeroRange(FileHandle* handle, qint64 pos, qint64 size);
+
+            // false if written data could not be flushed to the device
+            bool sync(FileHandle* handle);
         }
     }
 }
@@ -1,5 +1,12 @@
 
-HEADERS += $$PWD/native.h
+HEADERS += \
+    $$PWD/native.h \
+    $$PWD/crc32.h \
+    $$PWD/trace.h \
+
+SOURCES += \
+    $$PWD/crc32.cpp \
+    $$PWD/trace.cpp \
 
 win32 {
     SOURCES += \
@@ -7,8 +14,15 @@ win32 {
 }
 
 linux {
+    HEADERS += \
+        $$PWD/linux_utils/linux_utils.h \
+
     SOURCES += \
         $$PWD/linux_native.cpp \
+        $$PWD/linux_utils/linux_utils.cpp \
+        $$PWD/linux_utils/mount_table.cpp \
+        $$PWD/linux_utils/partition_table.cpp \
+        $$PWD/linux_utils/sysfs_scanner.cpp \
 }
 
 macx {
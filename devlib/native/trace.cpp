@@ -0,0 +1,209 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // per thread; the oldest events are overwritten once it is full.
+    // Allocated a block at a time, most threads record a few events
+    constexpr auto Trace_capacity = quint64(1) << 15;
+    constexpr auto Trace_blockEvents = quint64(1) << 9;
+    constexpr auto Trace_blocks = Trace_capacity / Trace_blockEvents;
+
+
+    struct Event {
+        char const* category;
+        char const* name;
+        QString detail;
+        qint64 begin;
+        qint64 duration;    // -1 for counters
+        qint64 value;
+    };
+
+
+    // Written by its own thread only. `written` is published with
+    // release, so the reader sees every event below it complete, and
+    // the blocks holding them allocated.
+    struct ThreadBuffer {
+        int tid = 0;
+        std::array<std::unique_ptr<Event[]>, Trace_blocks> blocks;
+        std::atomic<quint64> written{0};
+        quint64 from = 0;               // first one of the current session
+        std::atomic<bool> finished{false};
+
+        // for the writer, allocates the block on its first lap
+        auto slot(quint64 index) -> Event& {
+            auto& block = blocks[index % Trace_capacity / Trace_blockEvents];
+            if (!block) {
+                block.reset(new Event[Trace_blockEvents]);
+            }
+            return block[index % Trace_blockEvents];
+        }
+
+        auto event(quint64 index) const -> Event const& {
+            return blocks[index % Trace_capacity / Trace_blockEvents][index % Trace_blockEvents];
+        }
+    };
+
+
+    std::mutex Trace_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> Trace_buffers;
+    // of finished threads, dropped from the list by a new session;
+    // their blocks are taken over by the next threads that record
+    std::vector<std::shared_ptr<ThreadBuffer>> Trace_freeBuffers;
+    int Trace_nextTid = 1;
+    auto const Trace_epoch = Clock::now();
+
+
+    // Lives as long as the thread; its buffer stays listed for
+    // chromeTrace() until the next session starts, then it is reused
+    struct ThreadEntry {
+        std::shared_ptr<ThreadBuffer> buffer;
+
+        ~ThreadEntry(void) {
+            if (buffer) {
+                buffer->finished = true;
+            }
+        }
+    };
+
+    thread_local ThreadEntry Trace_thread;
+
+
+    auto threadBuffer(void) -> ThreadBuffer& {
+        if (!Trace_thread.buffer) {
+            std::lock_guard<std::mutex> lock(Trace_mutex);
+            auto buffer = std::shared_ptr<ThreadBuffer>();
+
+            if (Trace_freeBuffers.empty()) {
+                buffer = std::make_shared<ThreadBuffer>();
+            } else {
+                buffer = std::move(Trace_freeBuffers.back());
+                Trace_freeBuffers.pop_back();
+                buffer->written = 0;
+                buffer->from = 0;
+                buffer->finished = false;
+            }
+
+            buffer->tid = Trace_nextTid++;
+            Trace_buffers.push_back(buffer);
+            Trace_thread.buffer = std::move(buffer);
+        }
+
+        return *Trace_thread.buffer;
+    }
+
+
+    void record(Event event) {
+        auto& buffer = threadBuffer();
+        auto index = buffer.written.load(std::memory_order_relaxed);
+
+        buffer.slot(index) = std::move(event);
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+
+
+    auto toMicroseconds(qint64 nanoseconds) {
+        return double(nanoseconds) / 1000;
+    }
+}
+
+
+std::atomic<bool> devlib::native::trace::enabledFlag(false);
+
+
+void devlib::native::trace::setEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(Trace_mutex);
+
+    if (enabled && !isEnabled()) {
+        auto finished = std::stable_partition(Trace_buffers.begin(), Trace_buffers.end(),
+            [] (auto const& buffer) { return !buffer->finished.load(); }
+        );
+        std::move(finished, Trace_buffers.end(), std::back_inserter(Trace_freeBuffers));
+        Trace_buffers.erase(finished, Trace_buffers.end());
+
+        for (auto const& buffer : Trace_buffers) {
+            buffer->from = buffer->written.load(std::memory_order_acquire);
+        }
+    }
+
+    enabledFlag = enabled;
+}
+
+
+auto devlib::native::trace::timestamp(void)
+    -> qint64
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - Trace_epoch
+    ).count();
+}
+
+
+void devlib::native::trace::complete(char const* category, char const* name,
+                                     QString const& detail, qint64 begin)
+{
+    record(Event{ category, name, detail, begin, timestamp() - begin, 0 });
+}
+
+
+void devlib::native::trace::counter(char const* category, char const* name, qint64 value)
+{
+    if (isEnabled()) {
+        record(Event{ category, name, QString(), timestamp(), -1, value });
+    }
+}
+
+
+auto devlib::native::trace::chromeTrace(void)
+    -> QByteArray
+{
+    auto pid = QCoreApplication::applicationPid();
+    auto events = QJsonArray();
+
+    std::lock_guard<std::mutex> lock(Trace_mutex);
+
+    for (auto const& buffer : Trace_buffers) {
+        auto written = buffer->written.load(std::memory_order_acquire);
+        auto first = qMax(buffer->from, written > Trace_capacity ? written - Trace_capacity : 0);
+
+        for (auto index = first; index < written; index++) {
+            auto const& event = buffer->event(index);
+            auto json = QJsonObject{
+                { "cat", event.category },
+                { "name", event.name },
+                { "pid", pid },
+                { "tid", buffer->tid },
+                { "ts", toMicroseconds(event.begin) }
+            };
+
+            if (event.duration < 0) {
+                json.insert("ph", "C");
+                json.insert("args", QJsonObject{ { event.name, double(event.value) } });
+            } else {
+                json.insert("ph", "X");
+                json.insert("dur", toMicroseconds(event.duration));
+                if (!event.detail.isEmpty()) {
+                    json.insert("args", QJsonObject{ { "detail", event.detail } });
+                }
+            }
+
+            events.append(json);
+        }
+    }
+
+    auto trace = QJsonObject{
+        { "traceEvents", events },
+        { "displayTimeUnit", "ms" }
+    };
+
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,73 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QtCore>
+
+#include <atomic>
+
+namespace devlib {
+    namespace native {
+        // Timeline of what the library spends its time on, recorded per
+        // thread without locks and dumped as Chrome trace-event JSON.
+        // Off by default; while off a span or a counter costs one relaxed
+        // atomic load. `category` and `name` must be string literals.
+        namespace trace {
+            class Span;
+
+            extern std::atomic<bool> enabledFlag;
+
+            inline bool isEnabled(void) {
+                return enabledFlag.load(std::memory_order_relaxed);
+            }
+
+            // Enabling drops what was recorded before
+            void setEnabled(bool enabled);
+
+            // steady clock nanoseconds since the process started
+            auto timestamp(void) -> qint64;
+
+            void complete(char const* category, char const* name,
+                          QString const& detail, qint64 begin);
+
+            void counter(char const* category, char const* name, qint64 value);
+
+            // Meant for after setEnabled(false): threads still recording
+            // may overwrite their oldest events while they are read
+            auto chromeTrace(void) -> QByteArray;
+        }
+    }
+}
+
+
+// Records the scope it lives in as one complete ("X") event
+class devlib::native::trace::Span
+{
+public:
+    Span(char const* category, char const* name, QString const& detail = QString())
+        : _category(category),
+          _name(isEnabled() ? name : nullptr),
+          _begin(0)
+    {
+        if (_name) {
+            _detail = detail;
+            _begin = timestamp();
+        }
+    }
+
+    ~Span(void) {
+        if (_name) {
+            complete(_category, _name, _detail, _begin);
+        }
+    }
+
+    Span(Span const&) = delete;
+    Span& operator=(Span const&) = delete;
+
+private:
+    char const* _category;
+    char const* _name;      // nullptr when tracing was off
+    QString _detail;
+    qint64 _begin;
+};
+
+#endif // TRACE_H
@@ -172,11 +172,11 @@ namespace winutil {
 
 
     static auto findBusNumber(DEVINST const& handle, QMap<QString, int> & cachedDeviceBuses) {
-        static auto rootHubsBuses = QMap<QString, int>{};
-        if (rootHubsBuses.isEmpty()) {
+        // initialized once even with several threads enumerating
+        static auto const rootHubsBuses = [] () {
             qDebug(winlog()) << "Enumerating buses...";
-            rootHubsBuses = enumerateRootBuses();
-        }
+            return enumerateRootBuses();
+        }();
         qDebug(winlog()) << "Buses" << rootHubsBuses;
 
         auto currentDevInst = handle;
@@ -201,7 +201,7 @@ namespace winutil {
             auto parentInstanceId = QString::fromWCharArray(instanceID);
             qDebug(winlog()) << "parentInstanceId" << parentInstanceId;
             if (rootHubsBuses.contains(parentInstanceId)) {
-                bus = rootHubsBuses[parentInstanceId];
+                bus = rootHubsBuses.value(parentInstanceId);
                 break;
             }
             if (cachedDeviceBuses.contains(parentInstanceId)) {
@@ -458,17 +458,19 @@ auto devlib::native::umountPartition(QString const& mntpt)
 
 
 // Temporarily unsupported
-bool devlib::native::umountDisk(QString const & devicePath)
+auto devlib::native::umountDisk(QString const& devicePath,
+                                std::chrono::milliseconds deadline,
+                                bool lazyDetach) -> UmountReport
 {
-    Q_UNUSED(devicePath);
-    return false;
+    Q_UNUSED(devicePath); Q_UNUSED(deadline); Q_UNUSED(lazyDetach);
+    return { UmountStatus::NotHandled, {}, {} };
 }
 
 
 // Temporary unsupported
-bool devlib::native::mount(QString const& dev, QString const& path)
+bool devlib::native::mount(QString const& dev, QString const& path, QString const& fsType)
 {
-    Q_UNUSED(dev); Q_UNUSED(path);
+    Q_UNUSED(dev); Q_UNUSED(path); Q_UNUSED(fsType);
     return false;
 }
 
@@ -476,8 +478,7 @@ bool devlib::native::mount(QString const& dev, QString const& path)
 std::vector<QString> devlib::native::mntptsList(void)
 {
     auto mntptsInfo = QStorageInfo::mountedVolumes();
-    auto mntpts = std::vector<QString>();
-    mntpts.reserve(mntptsInfo.size());
+    auto mntpts = std::vector<QString>(mntptsInfo.size());
 
     std::transform(mntptsInfo.cbegin(), mntptsInfo.cend(), mntpts.begin(),
         [] (auto const& info) { return info.rootPath(); }
@@ -487,6 +488,18 @@ std::vector<QString> devlib::native::mntptsList(void)
 }
 
 
+bool devlib::native::isMountpoint(QString const& mntpt)
+{
+    auto volumes = QStorageInfo::mountedVolumes();
+
+    return std::any_of(volumes.cbegin(), volumes.cend(),
+        [&mntpt] (auto const& vol) {
+            return winutil::toMountpointPath(vol.rootPath()) == mntpt;
+        }
+    );
+}
+
+
 std::vector<std::pair<QString, QString>>
     devlib::native::mntptsForPartition(QString const& devFilePath)
 {
@@ -519,9 +532,27 @@ std::vector<std::pair<QString, QString>>
 }
 
 
+// Temporarily unsupported
+void devlib::native::setSystemRoots(SystemRoots const& roots)
+{
+    Q_UNUSED(roots);
+}
+
+
+// Temporarily unsupported
+auto devlib::native::systemRoots(void)
+    -> SystemRoots
+{
+    return SystemRoots();
+}
+
+
 std::vector<std::tuple<int, int, QString, QString>>
-    devlib::native::requestUsbDeviceList(void)
+    devlib::native::requestUsbDeviceList(DiscoveryBackend backend)
 {
+    // there is no sysfs, every backend means SetupAPI
+    Q_UNUSED(backend);
+
     auto devicesList = std::vector<std::tuple<int, int, QString, QString>>();
     auto usbDevicesByContainerIdsMap = winutil::getMapOfUsbDevicesByContainerIds();
     auto cachedDevicesBuses = QMap<QString, int>{};
@@ -570,12 +601,12 @@ std::vector<std::tuple<int, int, QString, QString>>
 
 
 auto devlib::native::devicePartitions(QString const& deviceName)
-    -> std::vector<std::tuple<QString, QString>>
+    -> std::vector<PartitionInfo>
 {
     auto mountedVols = QStorageInfo::mountedVolumes();
     auto driveNumber = winutil::driveNumberFromName(deviceName);
 
-    auto vols = std::vector<std::tuple<QString, QString>>();
+    auto vols = std::vector<PartitionInfo>();
 
     for (auto const& vol : mountedVols) {
         auto driveNums = winutil::drivesMountedToMountpoint(
@@ -583,7 +614,12 @@ auto devlib::native::devicePartitions(QString const& deviceName)
         );
 
         if (driveNums.contains(driveNumber)) {
-            vols.emplace_back(vol.device(), vol.name());
+            auto partition = PartitionInfo();
+            partition.filePath = vol.device();
+            partition.label = vol.name();
+            partition.fsType = QString(vol.fileSystemType());
+            partition.size = vol.bytesTotal();
+            vols.push_back(partition);
         }
     }
 
@@ -591,6 +627,118 @@ auto devlib::native::devicePartitions(QString const& deviceName)
 }
 
 
+// Temporarily unsupported
+auto devlib::native::deviceAttributes(QString const& devicePath)
+    -> DeviceAttributes
+{
+    Q_UNUSED(devicePath);
+    return {};
+}
+
+
+// Temporarily unsupported
+auto devlib::native::makeChangeMonitor(void)
+    -> std::unique_ptr<ChangeMonitor>
+{
+    return nullptr;
+}
+
+
+auto devlib::native::pollChanges(ChangeMonitor* monitor)
+    -> std::vector<ChangeEvent>
+{
+    Q_UNUSED(monitor);
+    return {};
+}
+
+
+// Temporarily unsupported
+auto devlib::native::serveLocalSocket(QString const& path,
+                                      std::function<QByteArray(QByteArray const&)> respond)
+    -> std::unique_ptr<LocalServer>
+{
+    Q_UNUSED(path); Q_UNUSED(respond);
+    return nullptr;
+}
+
+
+// Temporarily unsupported
+auto devlib::native::affinity::nodeCpus(int node)
+    -> std::vector<int>
+{
+    Q_UNUSED(node);
+    return {};
+}
+
+
+// Temporarily unsupported
+auto devlib::native::affinity::cpuNode(int cpu)
+    -> int
+{
+    Q_UNUSED(cpu);
+    return -1;
+}
+
+
+// Temporarily unsupported
+auto devlib::native::affinity::deviceNode(QString const& devicePath)
+    -> int
+{
+    Q_UNUSED(devicePath);
+    return -1;
+}
+
+
+// Temporarily unsupported
+bool devlib::native::affinity::pinCurrentThread(std::vector<int> const& cpus)
+{
+    Q_UNUSED(cpus);
+    return false;
+}
+
+
+// Temporarily unsupported
+auto devlib::native::affinity::currentThreadCpus(void)
+    -> std::vector<int>
+{
+    return {};
+}
+
+
+// Temporarily unsupported
+auto devlib::native::affinity::currentCpu(void)
+    -> int
+{
+    return -1;
+}
+
+
+// Temporarily unsupported
+bool devlib::native::affinity::preferNode(void* data, qint64 size, int node)
+{
+    Q_UNUSED(data); Q_UNUSED(size); Q_UNUSED(node);
+    return false;
+}
+
+
+// Temporarily unsupported
+auto devlib::native::memory::map(qint64 size, Pages pages, int node,
+                                 bool prefault, bool lock)
+    -> Mapping
+{
+    Q_UNUSED(size); Q_UNUSED(pages); Q_UNUSED(node);
+    Q_UNUSED(prefault); Q_UNUSED(lock);
+    return Mapping();
+}
+
+
+// Temporarily unsupported
+void devlib::native::memory::unmap(Mapping const& mapping)
+{
+    Q_UNUSED(mapping);
+}
+
+
 auto devlib::native::io::read(FileHandle* handle, char* data, qint64 sz)
     -> qint64
 {
@@ -678,13 +826,80 @@ auto devlib::native::io::authOpen(char const* filename)
 }
 
 
+auto devlib::native::io::openDirect(char const* filename, bool exclusive)
+    -> std::unique_ptr<FileHandle>
+{
+    auto handle = ::CreateFile(QString(filename).toStdWString().data(),
+                               GENERIC_READ,
+                               exclusive ? FILE_SHARE_READ
+                                         : FILE_SHARE_READ | FILE_SHARE_WRITE,
+                               NULL, OPEN_EXISTING,
+                               FILE_FLAG_NO_BUFFERING
+                               | FILE_FLAG_SEQUENTIAL_SCAN
+                               , NULL);
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+
+    return winutil::makeHandle(handle);
+}
+
+
+auto devlib::native::io::readAt(FileHandle* handle, char* data, qint64 sz, qint64 pos)
+    -> qint64
+{
+    auto winHandle = dynamic_cast<winutil::WinHandle*>(handle)->handle;
+
+    // offset in OVERLAPPED makes ReadFile positional on synchronous handles too
+    auto overlapped = OVERLAPPED();
+    overlapped.Offset = static_cast<DWORD>(pos & 0xFFFFFFFF);
+    overlapped.OffsetHigh = static_cast<DWORD>(pos >> 32);
+
+    auto read = DWORD(0);
+    if (!::ReadFile(winHandle, (void*)data, (DWORD)sz, &read, &overlapped)) {
+        return ::GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    }
+
+    return read;
+}
+
+
+auto devlib::native::io::writeAt(FileHandle* handle, char const* data, qint64 sz, qint64 pos)
+    -> qint64
+{
+    auto winHandle = dynamic_cast<winutil::WinHandle*>(handle)->handle;
+
+    auto overlapped = OVERLAPPED();
+    overlapped.Offset = static_cast<DWORD>(pos & 0xFFFFFFFF);
+    overlapped.OffsetHigh = static_cast<DWORD>(pos >> 32);
+
+    auto written = DWORD(0);
+    if (!::WriteFile(winHandle, (void const*)data, (DWORD)sz, &written, &overlapped)) {
+        return -1;
+    }
+
+    return written;
+}
+
+
 bool devlib::native::io::seek(FileHandle* handle, qint64 pos)
 {
     auto winHandle = dynamic_cast<winutil::WinHandle*>(handle)->handle;
-    auto result = ::SetFilePointer(winHandle, (LONG)pos, nullptr, FILE_BEGIN);
-    return result == INVALID_SET_FILE_POINTER;
+    auto distance = LARGE_INTEGER();
+    distance.QuadPart = pos;
+
+    return ::SetFilePointerEx(winHandle, distance, nullptr, FILE_BEGIN) != 0;
+}
+
+
+// Temporarily unsupported
+bool devlib::native::io::zeroRange(FileHandle* handle, qint64 pos, qint64 size)
+{
+    Q_UNUSED(handle); Q_UNUSED(pos); Q_UNUSED(size);
+    return false;
 }
 
 
-void devlib::native::io::sync(FileHandle* handle)
-{ Q_UNUSED(handle); /* temporary stub */ }
+bool devlib::native::io::sync(FileHandle* handle)
+{ Q_UNUSED(handle); /* temporary stub */ return true; }
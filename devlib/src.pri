@@ -1,14 +1,28 @@
 SOURCES += \
+        $$PWD/FlashScheduler.cpp \
+        $$PWD/Metrics.cpp \
         $$PWD/StorageDeviceService.cpp \
+        $$PWD/StorageSnapshot.cpp \
+        $$PWD/Tracing.cpp \
+        $$PWD/UsbTopology.cpp \
 
 
 HEADERS += \
         $$PWD/devlib.h \
+        $$PWD/Affinity.h \
+        $$PWD/BufferPolicy.h \
+        $$PWD/DeviceScan.h \
+        $$PWD/FlashScheduler.h \
+        $$PWD/Metrics.h \
         $$PWD/Mountpoint.h \
         $$PWD/Partition.h \
+        $$PWD/SpeedClass.h \
         $$PWD/StorageDeviceInfo.h \
         $$PWD/StorageDeviceFile.h \
         $$PWD/StorageDeviceService.h \
+        $$PWD/StorageSnapshot.h \
+        $$PWD/Tracing.h \
+        $$PWD/UsbTopology.h \
 
 
 ENABLE_HEADERS_COPY {
@@ -0,0 +1,110 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__SANITIZE_THREAD__) || defined(__SANITIZE_ADDRESS__)
+#  define BENCH_SANITIZED
+#elif defined(__has_feature)
+#  if __has_feature(thread_sanitizer) || __has_feature(address_sanitizer)
+#    define BENCH_SANITIZED
+#  endif
+#endif
+
+namespace {
+    std::atomic<long> Bench_allocations(0);
+}
+
+
+auto bench::allocations(void) -> long
+{
+    return Bench_allocations.load();
+}
+
+
+#if defined(__GLIBC__) && !defined(BENCH_SANITIZED)
+
+// Defined in the executable, these replace the glibc allocator entry
+// points for every library of the process, operator new included, and
+// forward to the glibc implementation.
+extern "C" {
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t count, std::size_t size);
+    void* __libc_realloc(void* ptr, std::size_t size);
+    void* __libc_memalign(std::size_t alignment, std::size_t size);
+    void __libc_free(void* ptr);
+
+
+    void* malloc(std::size_t size) noexcept
+    {
+        Bench_allocations++;
+        return __libc_malloc(size);
+    }
+
+
+    void* calloc(std::size_t count, std::size_t size) noexcept
+    {
+        Bench_allocations++;
+        return __libc_calloc(count, size);
+    }
+
+
+    void* realloc(void* ptr, std::size_t size) noexcept
+    {
+        Bench_allocations++;
+        return __libc_realloc(ptr, size);
+    }
+
+
+    void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+    {
+        Bench_allocations++;
+        return __libc_memalign(alignment, size);
+    }
+
+
+    int posix_memalign(void** ptr, std::size_t alignment, std::size_t size) noexcept
+    {
+        if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+            return EINVAL;
+        }
+
+        Bench_allocations++;
+        auto allocated = __libc_memalign(alignment, size);
+        if (allocated == nullptr) {
+            return ENOMEM;
+        }
+
+        *ptr = allocated;
+        return 0;
+    }
+
+
+    // glibc wants free() replaced along with malloc()
+    void free(void* ptr) noexcept
+    {
+        __libc_free(ptr);
+    }
+}
+
+#else
+
+void* operator new(std::size_t size)
+{
+    Bench_allocations++;
+
+    if (auto ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+namespace bench {
+    // Heap allocation calls made by the whole process so far. With glibc
+    // malloc, calloc, realloc and the aligned variants are counted, from
+    // whichever library they come: Qt, libudev and libblkid included.
+    // Elsewhere, and in sanitizer builds which hook malloc themselves,
+    // only operator new is.
+    auto allocations(void) -> long;
+
+    template<typename Func>
+    auto countAllocations(Func&& func) -> long {
+        auto before = allocations();
+        func();
+        return allocations() - before;
+    }
+}
+
+#endif // ALLOCATION_COUNTER_H
@@ -0,0 +1,7 @@
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/allocation_counter.cpp \
+
+HEADERS += \
+    $$PWD/allocation_counter.h \
@@ -0,0 +1,236 @@
+#include "devlib.h"
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+    template<typename Func>
+    auto measureMs(Func&& func) {
+        auto begin = std::chrono::steady_clock::now();
+        func();
+        auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+
+
+    // Cold enumeration of all attached devices with different probe pool
+    // sizes. With one thread probes run one after another, so the time
+    // grows with device count; with a pool it grows with the slowest one.
+    // devlib_enum_bench gives the time against 1 to 64 generated devices.
+    void benchSnapshot(devlib::StorageDeviceService& service)
+    {
+        qInfo() << "snapshot: threads | devices | partitions | ms";
+
+        for (auto threads : { 1, 2, 4, 8, 16, 32 }) {
+            service.setProbeLimits(threads, std::chrono::seconds(5));
+            service.rescan();
+
+            auto snapshot = devlib::StorageSnapshot();
+            auto elapsed = measureMs([&] () { snapshot = service.snapshot(); });
+
+            auto partitionsCount = std::size_t(0);
+            for (auto const& device : snapshot.devices()) {
+                partitionsCount += snapshot.partitions(device).size();
+            }
+
+            qInfo() << "         " << threads
+                    << "|" << snapshot.devices().size()
+                    << "|" << partitionsCount
+                    << "|" << elapsed;
+        }
+    }
+
+
+    auto deviceList(devlib::StorageDeviceService& service) {
+        auto list = QStringList();
+
+        for (auto const& device : service.getAvailableStorageDevices()) {
+            list << QString("%1:%2 %3 %4")
+                    .arg(device->vid(), 4, 16, QChar('0'))
+                    .arg(device->pid(), 4, 16, QChar('0'))
+                    .arg(device->filePath())
+                    .arg(device->usbPortPath());
+        }
+
+        return list;
+    }
+
+
+    // Device list from scratch through each discovery backend. Both
+    // have to report the same devices, only the cost should differ.
+    void benchDiscovery(devlib::StorageDeviceService& service)
+    {
+        using Backend = devlib::StorageDeviceService::DiscoveryBackend;
+
+        auto const iterations = 200;
+        auto const backends = {
+            std::make_pair(Backend::Platform, "platform"),
+            std::make_pair(Backend::Sysfs, "sysfs")
+        };
+
+        qInfo() << "discovery: backend | devices | ms per list";
+
+        auto reference = QStringList();
+        for (auto const& backend : backends) {
+            service.setDiscoveryBackend(backend.first);
+
+            auto list = QStringList();
+            auto elapsed = measureMs([&] () {
+                for (auto i = 0; i < iterations; i++) {
+                    service.rescan();
+                    list = deviceList(service);
+                }
+            });
+
+            qInfo() << "          " << backend.second
+                    << "|" << list.size()
+                    << "|" << elapsed / iterations;
+
+            if (reference.isEmpty()) {
+                reference = list;
+            } else if (list != reference) {
+                qWarning() << "backends disagree:" << reference << list;
+            }
+        }
+
+        service.setDiscoveryBackend(Backend::Platform);
+    }
+
+
+    // Heap allocation calls of one pass of a typical monitoring loop and of
+    // one snapshot, with warm caches. Run it on trees before and after a
+    // change of the object model to compare.
+    void benchAllocations(devlib::StorageDeviceService& service)
+    {
+        auto const iterations = 100;
+
+        auto monitor = [&service] () {
+            for (auto const& device : service.getAvailableStorageDevices()) {
+                device->serial();
+                device->mountpoints();
+
+                for (auto const& partition : device->partitions()) {
+                    partition->mountpoints();
+                }
+            }
+        };
+
+        // fill the caches first
+        monitor();
+        service.snapshot();
+
+        auto enumerations = bench::countAllocations([&] () {
+            for (auto i = 0; i < iterations; i++) {
+                monitor();
+            }
+        });
+        auto snapshots = bench::countAllocations([&] () {
+            for (auto i = 0; i < iterations; i++) {
+                service.snapshot();
+            }
+        });
+
+        qInfo() << "allocations: devices | per enumeration | per snapshot";
+        qInfo() << "            " << service.getAvailableStorageDevices().size()
+                << "|" << double(enumerations) / iterations
+                << "|" << double(snapshots) / iterations;
+    }
+
+
+    // Every query of the service from many threads at once while another
+    // one keeps dropping the cache. Meant for a DEVLIB_WITH_TSAN build:
+    // the numbers only show that nothing got serialized.
+    void stressService(devlib::StorageDeviceService& service, int seconds)
+    {
+        auto const threadsCount = 16;
+        auto stop = std::atomic<bool>(false);
+        auto queries = std::atomic<long>(0);
+
+        auto query = [&service, &stop, &queries] (int index) {
+            while (!stop) {
+                switch (index % 4) {
+                case 0:
+                    for (auto const& device : service.getAvailableStorageDevices()) {
+                        device->serial();
+                        device->capacity();
+                        device->mountpoints();
+
+                        for (auto const& partition : device->partitions()) {
+                            partition->mountpoints();
+                        }
+                    }
+                    break;
+                case 1:
+                    service.snapshot();
+                    break;
+                case 2:
+                    service.usbTopology();
+                    break;
+                case 3:
+                    deviceList(service);
+                    break;
+                }
+                queries++;
+            }
+        };
+
+        auto threads = std::vector<std::thread>();
+        for (auto i = 0; i < threadsCount; i++) {
+            threads.emplace_back(query, i);
+        }
+
+        threads.emplace_back([&service, &stop] () {
+            using Backend = devlib::StorageDeviceService::DiscoveryBackend;
+
+            for (auto i = 0; !stop; i++) {
+                service.setDiscoveryBackend(i % 2 ? Backend::Sysfs : Backend::Platform);
+                service.setProbeLimits(1 + i % 8, std::chrono::seconds(5));
+                service.rescan();
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        });
+
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        stop = true;
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        qInfo() << "stress: threads | seconds | queries";
+        qInfo() << "       " << threadsCount << "|" << seconds << "|" << queries.load();
+    }
+}
+
+
+// devlib_bench [--stress [seconds] | --trace file.json]
+int main(int argc, char *argv[])
+{
+    auto service = devlib::StorageDeviceService::instance();
+    Q_ASSERT(service.get());
+
+    if (argc > 1 && QString(argv[1]) == "--stress") {
+        auto seconds = argc > 2 ? QString(argv[2]).toInt() : 10;
+        stressService(*service, qMax(seconds, 1));
+        return 0;
+    }
+
+    auto traceFile = argc > 2 && QString(argv[1]) == "--trace" ? QString(argv[2]) : QString();
+    if (!traceFile.isEmpty()) {
+        devlib::Tracing::start();
+    }
+
+    benchDiscovery(*service);
+    benchSnapshot(*service);
+
+    if (!traceFile.isEmpty()) {
+        devlib::Tracing::stop();
+        devlib::Tracing::writeChromeTrace(traceFile);
+        return 0;
+    }
+
+    benchAllocations(*service);
+}
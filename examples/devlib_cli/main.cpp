@@ -1,21 +1,91 @@
 #include "devlib.h"
 
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // One line per region and a strip with a character per region,
+    // '#' for the slowest reads and ' ' for the fastest
+    void dumpHeatMap(devlib::HeatMap const& heatMap)
+    {
+        static auto const shades = QString("#%*+=-:. ");
+
+        auto slowest = std::numeric_limits<float>::max();
+        auto fastest = 0.0f;
+        for (auto const& region : heatMap.regions) {
+            slowest = std::min(slowest, region.readMBps);
+            fastest = std::max(fastest, region.readMBps);
+        }
+
+        qInfo() << "offset MiB | read MB/s | max read ms | write MB/s | max write ms";
+
+        auto strip = QString();
+        for (auto i = std::size_t(0); i < heatMap.regions.size(); i++) {
+            auto const& region = heatMap.regions[i];
+
+            qInfo().noquote() << QString("%1 | %2 | %3 | %4 | %5")
+                .arg(i * heatMap.regionSize / (1024 * 1024), 10)
+                .arg(region.readMBps, 9, 'f', 1)
+                .arg(region.maxReadMs, 11, 'f', 1)
+                .arg(region.writeMBps, 10, 'f', 1)
+                .arg(region.maxWriteMs, 12, 'f', 1);
+
+            auto spread = fastest - slowest;
+            auto level = spread > 0 ? (region.readMBps - slowest) / spread : 1.0f;
+            strip += shades.at(qRound(level * (shades.size() - 1)));
+        }
+
+        qInfo().noquote() << '[' + strip + ']';
+        if (!heatMap.completed) {
+            qInfo() << "scan stopped by an I/O error";
+        }
+    }
+}
+
+
 int main(int argc, char *argv[])
 {
-    Q_UNUSED(argc)
-    Q_UNUSED(argv)
+    auto arguments = QStringList();
+    for (auto i = 1; i < argc; i++) {
+        arguments << QString::fromLocal8Bit(argv[i]);
+    }
 
     auto service = devlib::StorageDeviceService::instance();
     Q_ASSERT(service.get());
 
     auto devices = service->getAvailableStorageDevices();
 
+    // devlib_cli --scan /dev/sdX: read-only heat map of the device
+    auto scanIndex = arguments.indexOf("--scan");
+    if (scanIndex != -1 && scanIndex + 1 < arguments.size()) {
+        auto path = arguments.at(scanIndex + 1);
+        auto found = std::find_if(devices.begin(), devices.end(),
+            [&path] (auto const& device) { return device->filePath() == path; });
+
+        if (found == devices.end()) {
+            qWarning() << path << "is not an available storage device";
+            return 1;
+        }
+
+        auto file = service->makeStorageDeviceFile(
+            path, std::shared_ptr<devlib::IStorageDeviceInfo>(std::move(*found))
+        );
+        dumpHeatMap(file->scan());
+        return 0;
+    }
+
     for (auto const& device : devices) {
         qInfo() << "device" << '\n'
                 << "+ vid: " << device->vid() << '\n'
                 << "+ pid: " << device->pid() << '\n'
                 << "+ fsPath: " << device->filePath() << '\n'
-                << "+ usbPortPath: " << device->usbPortPath();
+                << "+ usbPortPath: " << device->usbPortPath() << '\n'
+                << "+ capacity: " << device->capacity() << '\n'
+                << "+ vendor: " << device->vendorName() << '\n'
+                << "+ model: " << device->model() << '\n'
+                << "+ serial: " << device->serial() << '\n'
+                << "+ removable: " << device->isRemovable() << '\n'
+                << "+ readOnly: " << device->isReadOnly();
 
         qInfo() << "\n + mntpts:";
         for (auto const& mntpt : device->mountpoints()) {
@@ -25,7 +95,11 @@ int main(int argc, char *argv[])
         qInfo() << "\n + partitions(volumes):";
         for (auto const& part : device->partitions()) {
             qInfo() << "   +- name: " << part->filePath() << '\n'
-                    << "  +- label: " << part->label();
+                    << "  +- label: " << part->label() << '\n'
+                    << "  +- fsType: " << part->fsType() << '\n'
+                    << "  +- uuid: " << part->uuid() << '\n'
+                    << "  +- start: " << part->start() << '\n'
+                    << "  +- size: " << part->size();
             qInfo() << "   +- Mounpoints:";
 
             for (auto const& mntpt : part->mountpoints()) {
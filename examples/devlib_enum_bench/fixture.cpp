@@ -0,0 +1,144 @@
+#include "fixture.h"
+
+#include <unistd.h>
+
+namespace {
+    constexpr auto Fixture_diskSectors = qint64(32768);     // 16 MiB images
+    constexpr auto Fixture_portsPerHub = 8;
+    constexpr auto Fixture_sdMajor = 8;
+
+    // start and length in 512-byte sectors, type 0x0c (FAT32 LBA)
+    constexpr qint64 Fixture_partitions[][2] = { { 2048, 8192 }, { 10240, 20480 } };
+
+
+    // sda .. sdz, sdaa .. sdaz, ... as the kernel names them
+    auto diskName(int index) {
+        auto name = QString("sd");
+        if (index >= 26) {
+            name += QChar('a' + index / 26 - 1);
+        }
+        return name + QChar('a' + index % 26);
+    }
+
+
+    bool writeFile(QString const& path, QByteArray const& content) {
+        QDir().mkpath(QFileInfo(path).path());
+
+        QFile file(path);
+        return file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            && file.write(content) == content.size();
+    }
+
+
+    bool link(QString const& target, QString const& path) {
+        QDir().mkpath(QFileInfo(path).path());
+        QFile::remove(path);
+        return ::symlink(target.toLocal8Bit().constData(), path.toLocal8Bit().constData()) == 0;
+    }
+
+
+    // Relative symlink target from the directory of `from` to `to`,
+    // as sysfs links are
+    auto relativeTarget(QString const& from, QString const& to) {
+        return QDir(QFileInfo(from).path()).relativeFilePath(to);
+    }
+
+
+    void putLittleEndian(QByteArray& data, int offset, quint32 value) {
+        for (auto i = 0; i < 4; i++) {
+            data[offset + i] = char((value >> (8 * i)) & 0xff);
+        }
+    }
+
+
+    // Sparse image with an MBR, contents of the partitions are left zero
+    bool writeImage(QString const& path) {
+        auto mbr = QByteArray(512, '\0');
+
+        for (auto i = 0; i < 2; i++) {
+            auto entry = 446 + 16 * i;
+            mbr[entry + 4] = char(0x0c);
+            putLittleEndian(mbr, entry + 8, quint32(Fixture_partitions[i][0]));
+            putLittleEndian(mbr, entry + 12, quint32(Fixture_partitions[i][1]));
+        }
+        mbr[510] = char(0x55);
+        mbr[511] = char(0xaa);
+
+        QFile image(path);
+        return image.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            && image.write(mbr) == mbr.size()
+            && image.resize(Fixture_diskSectors * 512);
+    }
+}
+
+
+bool fixture::write(QString const& root, int devicesCount)
+{
+    auto sys = root + "/sys";
+    auto controller = sys + "/devices/pci0000:00/0000:00:14.0/usb1/1-1";
+    auto mountinfo = QByteArray(
+        "22 1 259:2 / / rw,relatime shared:1 - ext4 /dev/nvme0n1p2 rw\n"
+    );
+    auto ok = true;
+
+    for (auto i = 0; i < devicesCount; i++) {
+        auto name = diskName(i);
+        auto minor = 16 * i;
+        auto portPath = QString("1-1.%1.%2")
+            .arg(i / Fixture_portsPerHub + 1).arg(i % Fixture_portsPerHub + 1);
+
+        auto usbDevice = QString("%1/1-1.%2/%3").arg(controller).arg(i / Fixture_portsPerHub + 1).arg(portPath);
+        auto disk = QString("%1/%2:1.0/host%3/target%3:0:0/%3:0:0:0/block/%4")
+            .arg(usbDevice).arg(portPath).arg(i).arg(name);
+        auto dev = QString("%1:%2").arg(Fixture_sdMajor).arg(minor);
+
+        ok = ok && writeFile(usbDevice + "/idVendor", "0781\n")
+                && writeFile(usbDevice + "/idProduct", "5567\n")
+                && writeFile(disk + "/dev", dev.toLatin1() + '\n')
+                && writeFile(disk + "/size", QByteArray::number(Fixture_diskSectors) + '\n')
+                && writeFile(disk + "/removable", "1\n")
+                && writeFile(disk + "/ro", "0\n")
+                && writeFile(disk + "/uevent", QString("MAJOR=%1\nMINOR=%2\nDEVNAME=%3\nDEVTYPE=disk\n")
+                                                   .arg(Fixture_sdMajor).arg(minor).arg(name).toLatin1())
+                && link(relativeTarget(sys + "/class/block/" + name, disk), sys + "/class/block/" + name)
+                && link(relativeTarget(sys + "/dev/block/" + dev, disk), sys + "/dev/block/" + dev)
+                && writeFile(QString("%1/run/udev/data/b%2").arg(root).arg(dev),
+                             QString("E:ID_VENDOR=SanDisk\nE:ID_MODEL=Cruzer_Blade\n"
+                                     "E:ID_VENDOR_ID=0781\nE:ID_MODEL_ID=5567\n"
+                                     "E:ID_SERIAL_SHORT=4C53%1\n").arg(i, 12, 10, QChar('0')).toLatin1())
+                && writeImage(root + "/dev/" + name);
+
+        for (auto number = 1; ok && number <= 2; number++) {
+            auto partName = name + QString::number(number);
+            auto part = disk + "/" + partName;
+            auto partDev = QString("%1:%2").arg(Fixture_sdMajor).arg(minor + number);
+
+            ok = writeFile(part + "/dev", partDev.toLatin1() + '\n')
+                && writeFile(part + "/partition", QByteArray::number(number) + '\n')
+                && writeFile(part + "/start", QByteArray::number(Fixture_partitions[number - 1][0]) + '\n')
+                && writeFile(part + "/size", QByteArray::number(Fixture_partitions[number - 1][1]) + '\n')
+                && writeFile(part + "/uevent", QString("MAJOR=%1\nMINOR=%2\nDEVNAME=%3\nDEVTYPE=partition\n")
+                                                   .arg(Fixture_sdMajor).arg(minor + number).arg(partName).toLatin1())
+                && link(relativeTarget(sys + "/class/block/" + partName, part), sys + "/class/block/" + partName)
+                && link(relativeTarget(sys + "/dev/block/" + partDev, part), sys + "/dev/block/" + partDev)
+                && writeFile(root + "/dev/" + partName, QByteArray());
+        }
+
+        mountinfo += QString("%1 22 %2:%3 / /media/station/%4 rw,nosuid,nodev,relatime shared:%1 - vfat %5/dev/%4 rw\n")
+            .arg(100 + i).arg(Fixture_sdMajor).arg(minor + 1).arg(name + "1").arg(root).toUtf8();
+    }
+
+    return ok && writeFile(root + "/proc/self/mountinfo", mountinfo);
+}
+
+
+auto fixture::roots(QString const& root)
+    -> devlib::native::SystemRoots
+{
+    auto roots = devlib::native::SystemRoots();
+    roots.sys = root + "/sys";
+    roots.dev = root + "/dev";
+    roots.proc = root + "/proc";
+    roots.udev = root + "/run/udev";
+    return roots;
+}
@@ -0,0 +1,22 @@
+#ifndef FIXTURE_H
+#define FIXTURE_H
+
+#include "native/native.h"
+
+#include <QtCore>
+
+namespace fixture {
+    // Writes the part of a Linux system the enumeration reads, laid out
+    // the way it was recorded from a station: USB disks behind 8-port
+    // hubs on one xHCI controller, each with an MBR image holding two
+    // partitions, the first one mounted.
+    //   sys/devices/..., sys/class/block, sys/dev/block
+    //   dev/<disk>, dev/<partition>     images instead of device nodes
+    //   run/udev/data/b<major>:<minor>
+    //   proc/self/mountinfo
+    bool write(QString const& root, int devicesCount);
+
+    auto roots(QString const& root) -> devlib::native::SystemRoots;
+}
+
+#endif // FIXTURE_H
@@ -0,0 +1,163 @@
+#include "devlib.h"
+#include "fixture.h"
+#include "allocation_counter.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    using namespace devlib;
+
+    struct Result {
+        double p50;     // us
+        double p99;     // us
+        double allocs;  // per call
+    };
+
+
+    // Calls `func` `iterations` times after one warm-up call, which also
+    // lets the mount table and the scanner parse their files
+    template<typename Func>
+    auto measure(int iterations, Func&& func) {
+        func();
+
+        auto samples = std::vector<double>();
+        samples.reserve(iterations);
+        auto allocations = long(0);
+
+        for (auto i = 0; i < iterations; i++) {
+            auto before = bench::allocations();
+            auto begin = std::chrono::steady_clock::now();
+            func();
+            auto end = std::chrono::steady_clock::now();
+            allocations += bench::allocations() - before;
+
+            samples.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+        }
+
+        std::sort(samples.begin(), samples.end());
+        auto at = [&samples] (double quantile) {
+            return samples.at(std::size_t(quantile * (samples.size() - 1)));
+        };
+
+        return Result { at(0.50), at(0.99), double(allocations) / iterations };
+    }
+
+
+    void report(char const* api, std::size_t devicesCount, Result const& result) {
+        qInfo().noquote() << QString("%1 | %2 | %3 | %4 | %5")
+                             .arg(QString::fromLatin1(api), -20).arg(devicesCount, 7)
+                             .arg(result.p50, 8, 'f', 1).arg(result.p99, 8, 'f', 1)
+                             .arg(result.allocs, 7, 'f', 1);
+    }
+
+
+    // Per-call numbers for the enumeration API over the devices of the
+    // current roots. Partition and mountpoint calls cycle over all disks,
+    // so a call is averaged over the whole fixture rather than one disk.
+    void benchRoots(int iterations)
+    {
+        using Backend = native::DiscoveryBackend;
+
+        auto devices = native::requestUsbDeviceList(Backend::Sysfs);
+        if (devices.empty()) {
+            qWarning() << "no devices under" << native::systemRoots().sys;
+            return;
+        }
+
+        auto disks = std::vector<QString>();
+        auto partitions = std::vector<QString>();
+
+        for (auto const& device : devices) {
+            disks.push_back(std::get<2>(device));
+
+            for (auto const& partition : native::devicePartitions(std::get<2>(device))) {
+                partitions.push_back(partition.filePath);
+            }
+        }
+
+        auto count = devices.size();
+        auto next = std::size_t(0);
+
+        report("requestUsbDeviceList", count, measure(iterations, [] () {
+            native::requestUsbDeviceList(Backend::Sysfs);
+        }));
+
+        report("devicePartitions", count, measure(iterations, [&] () {
+            native::devicePartitions(disks.at(next++ % disks.size()));
+        }));
+
+        report("deviceAttributes", count, measure(iterations, [&] () {
+            native::deviceAttributes(disks.at(next++ % disks.size()));
+        }));
+
+        // whole cold enumeration as applications see it, for time
+        // against device count; each call probes every disk again
+        auto service = StorageDeviceService::instance();
+        service->setDiscoveryBackend(StorageDeviceService::DiscoveryBackend::Sysfs);
+
+        report("snapshot (cold)", count, measure(qMax(iterations / 10, 1), [&service] () {
+            service->rescan();
+            service->snapshot();
+        }));
+
+        if (partitions.empty()) {
+            return;
+        }
+
+        report("mntptsForPartition", count, measure(iterations, [&] () {
+            native::mntptsForPartition(partitions.at(next++ % partitions.size()));
+        }));
+    }
+
+
+    void printHeader(void) {
+        qInfo().noquote() << "api                  | devices |   p50 us |   p99 us |  allocs";
+    }
+}
+
+
+// devlib_enum_bench [--iterations N] [--fixture root]
+//
+// Without --fixture generates trees with 1 to 64 devices, see fixture.h.
+// Only the Sysfs discovery backend follows the roots, libudev always
+// reads the live system.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    auto arguments = app.arguments();
+    auto option = [&arguments] (QString const& name) {
+        auto index = arguments.indexOf(name);
+        return index != -1 && index + 1 < arguments.size() ? arguments.at(index + 1) : QString();
+    };
+
+    auto iterations = qMax(option("--iterations").toInt(), 0);
+    if (iterations == 0) {
+        iterations = 1000;
+    }
+
+    auto recorded = option("--fixture");
+    printHeader();
+
+    if (!recorded.isEmpty()) {
+        native::setSystemRoots(fixture::roots(recorded));
+        benchRoots(iterations);
+        return 0;
+    }
+
+    for (auto devicesCount : { 1, 2, 4, 8, 16, 32, 64 }) {
+        QTemporaryDir root;
+
+        if (!root.isValid() || !fixture::write(root.path(), devicesCount)) {
+            qWarning() << "can not write fixture to" << root.path();
+            return 1;
+        }
+
+        native::setSystemRoots(fixture::roots(root.path()));
+        benchRoots(iterations);
+    }
+
+    native::setSystemRoots(native::SystemRoots());
+    return 0;
+}
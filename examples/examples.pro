@@ -2,3 +2,10 @@ TEMPLATE=subdirs
 
 SUBDIRS += \
    devlib_cli \
+   devlib_bench \
+
+# its sysfs fixture uses <unistd.h> and symlink()
+linux {
+   SUBDIRS += \
+      devlib_enum_bench \
+}
@@ -0,0 +1,165 @@
+#include "impl/CapacityProbe.h"
+#include "impl/IoBuffer.h"
+
+#include <QtTest>
+
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+    constexpr auto GiB = qint64(1024) * 1024 * 1024;
+    constexpr auto Block = devlib::impl::CapacityProbe::BlockSize;
+
+
+    // Card reporting `capacity` bytes while storing only `realSize` of
+    // them. Addresses past the real size wrap around onto lower blocks,
+    // as cards that ignore the high address bits do, or with
+    // `dropsWrites` their writes get lost. Blocks never written read as
+    // a pattern of their physical offset, so restoring can be checked.
+    class FakeCard : public devlib::impl::ProbeDevice
+    {
+    public:
+        FakeCard(qint64 capacity, qint64 realSize, bool dropsWrites = false)
+            : _capacity(capacity),
+              _realSize(realSize),
+              _dropsWrites(dropsWrites)
+        { }
+
+        bool readAt(char* data, qint64 size, qint64 offset) override {
+            if (!inRange(size, offset)) {
+                return false;
+            }
+
+            for (auto done = qint64(0); done < size; done += Block) {
+                auto content = block(offset + done);
+                std::memcpy(data + done, content.constData(), Block);
+            }
+            return true;
+        }
+
+        bool writeAt(char const* data, qint64 size, qint64 offset) override {
+            if (!inRange(size, offset)) {
+                return false;
+            }
+
+            for (auto done = qint64(0); done < size; done += Block) {
+                if (_dropsWrites && offset + done >= _realSize) {
+                    continue;
+                }
+                _blocks[physical(offset + done)] = QByteArray(data + done, int(Block));
+            }
+            return true;
+        }
+
+        void sync(void) override { }
+
+        // every block written so far holds what it held at the start
+        bool untouched(void) const {
+            for (auto const& stored : _blocks) {
+                if (stored.second != background(stored.first)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        bool inRange(qint64 size, qint64 offset) const {
+            return size % Block == 0 && offset % Block == 0
+                && offset >= 0 && offset + size <= _capacity;
+        }
+
+        auto physical(qint64 offset) const {
+            return _dropsWrites ? offset : offset % _realSize;
+        }
+
+        auto block(qint64 offset) const {
+            if (_dropsWrites && offset >= _realSize) {
+                return QByteArray(int(Block), '\0');
+            }
+
+            auto stored = _blocks.find(physical(offset));
+            return stored != _blocks.cend() ? stored->second : background(physical(offset));
+        }
+
+        static auto background(qint64 offset) -> QByteArray {
+            auto content = QByteArray(int(Block), '\0');
+            devlib::impl::fillPseudoRandom(content.data(), Block, quint64(offset));
+            return content;
+        }
+
+        qint64 _capacity;
+        qint64 _realSize;
+        bool _dropsWrites;
+        std::unordered_map<qint64, QByteArray> _blocks;
+    };
+}
+
+
+class CapacityProbeTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void detectsWrapAround_data(void);
+    void detectsWrapAround(void);
+    void detectsDroppedWrites(void);
+    void acceptsGenuineCard(void);
+};
+
+
+void CapacityProbeTest::detectsWrapAround_data(void)
+{
+    QTest::addColumn<qint64>("capacity");
+    QTest::addColumn<qint64>("realSize");
+
+    QTest::newRow("32G on 4G") << 32 * GiB << 4 * GiB;
+    QTest::newRow("64G on 8G") << 64 * GiB << 8 * GiB;
+    QTest::newRow("128G on 16G") << 128 * GiB << 16 * GiB;
+    QTest::newRow("256G on 32G") << 256 * GiB << 32 * GiB;
+}
+
+
+void CapacityProbeTest::detectsWrapAround(void)
+{
+    QFETCH(qint64, capacity);
+    QFETCH(qint64, realSize);
+
+    FakeCard card(capacity, realSize);
+    auto result = devlib::impl::CapacityProbe(&card).run(capacity, 256, true);
+
+    QVERIFY(result.completed);
+    QVERIFY(result.isCounterfeit());
+    QVERIFY(result.firstBadOffset >= realSize);
+    QVERIFY(result.verifiedCapacity <= realSize);
+    QVERIFY(result.verifiedCapacity > realSize / 2);
+    QVERIFY(card.untouched());
+}
+
+
+void CapacityProbeTest::detectsDroppedWrites(void)
+{
+    FakeCard card(64 * GiB, 8 * GiB, true);
+    auto result = devlib::impl::CapacityProbe(&card).run(64 * GiB, 256, true);
+
+    QVERIFY(result.isCounterfeit());
+    QVERIFY(result.firstBadOffset >= 8 * GiB);
+    QVERIFY(result.verifiedCapacity <= 8 * GiB);
+}
+
+
+void CapacityProbeTest::acceptsGenuineCard(void)
+{
+    FakeCard card(64 * GiB, 64 * GiB);
+    auto result = devlib::impl::CapacityProbe(&card).run(64 * GiB, 256, true);
+
+    QVERIFY(result.completed);
+    QVERIFY(!result.isCounterfeit());
+    QCOMPARE(result.verifiedCapacity, 64 * GiB);
+    QVERIFY(card.untouched());
+}
+
+
+QTEST_APPLESS_MAIN(CapacityProbeTest)
+
+#include "tst_capacityprobe.moc"
@@ -0,0 +1,285 @@
+#include "fake_native.h"
+
+#include "native/native.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace {
+    struct Device {
+        QString usbPortPath;
+        int version = 0;
+        bool hung = false;
+        int probesRunning = 0;
+        int probesStarted = 0;
+        int maxConcurrentProbes = 0;
+    };
+
+
+    struct FakeMonitor : devlib::native::ChangeMonitor {
+        std::size_t received = 0;
+    };
+
+
+    std::mutex Fake_mutex;
+    std::condition_variable Fake_released;
+    QMap<QString, Device> Fake_devices;
+    std::vector<devlib::native::ChangeEvent> Fake_events;
+
+    // probes of unplugged devices are still counted
+    QMap<QString, Device> Fake_history;
+
+    // shared by all devices, so a label is never seen twice
+    int Fake_version = 0;
+
+
+    auto partitionPath(QString const& devicePath, int number) {
+        return devicePath + QString::number(number);
+    }
+
+
+    auto mountpointOf(QString const& partitionPath) {
+        return "/media/" + QFileInfo(partitionPath).fileName();
+    }
+
+
+    void pushEvent(devlib::native::ChangeKind kind, QString const& action,
+                   QString const& devicePath, QString const& parentPath = QString())
+    {
+        auto event = devlib::native::ChangeEvent();
+        event.kind = kind;
+        event.action = action;
+        event.devicePath = devicePath;
+        event.parentPath = parentPath;
+
+        if (kind == devlib::native::ChangeKind::Device) {
+            event.vid = 0x0781;
+            event.pid = 0x5567;
+            event.usbPortPath = Fake_devices.value(devicePath).usbPortPath;
+        }
+
+        Fake_events.push_back(event);
+    }
+
+
+    void pushPartitionEvents(QString const& action, QString const& devicePath) {
+        for (auto number = 1; number <= 2; number++) {
+            pushEvent(devlib::native::ChangeKind::Partition, action,
+                      partitionPath(devicePath, number), devicePath);
+        }
+    }
+}
+
+
+void fake::reset(void)
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+
+    for (auto& device : Fake_devices) {
+        device.hung = false;
+    }
+    Fake_released.notify_all();
+
+    Fake_devices.clear();
+    Fake_history.clear();
+    Fake_version = 0;
+}
+
+
+void fake::plug(QString const& devicePath, QString const& usbPortPath)
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+
+    auto& device = Fake_devices[devicePath];
+    device.usbPortPath = usbPortPath;
+    device.version = ++Fake_version;
+
+    using devlib::native::ChangeKind;
+    pushEvent(ChangeKind::Device, "add", devicePath);
+    pushPartitionEvents("add", devicePath);
+    pushEvent(ChangeKind::MountTable, "change", QString());
+}
+
+
+void fake::unplug(QString const& devicePath)
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+
+    if (!Fake_devices.contains(devicePath)) {
+        return;
+    }
+
+    Fake_devices.remove(devicePath);
+    Fake_released.notify_all();
+
+    using devlib::native::ChangeKind;
+    pushEvent(ChangeKind::MountTable, "change", QString());
+    pushPartitionEvents("remove", devicePath);
+    pushEvent(ChangeKind::Device, "remove", devicePath);
+}
+
+
+void fake::change(QString const& devicePath)
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+
+    if (!Fake_devices.contains(devicePath)) {
+        return;
+    }
+    Fake_devices[devicePath].version = ++Fake_version;
+
+    pushEvent(devlib::native::ChangeKind::Device, "change", devicePath);
+    pushPartitionEvents("change", devicePath);
+}
+
+
+void fake::hang(QString const& devicePath)
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+    Fake_devices[devicePath].hung = true;
+}
+
+
+void fake::release(QString const& devicePath)
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+
+    if (Fake_devices.contains(devicePath)) {
+        Fake_devices[devicePath].hung = false;
+    }
+    Fake_released.notify_all();
+}
+
+
+auto fake::devices(void) -> QMap<QString, int>
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+    auto versions = QMap<QString, int>();
+
+    for (auto it = Fake_devices.cbegin(); it != Fake_devices.cend(); ++it) {
+        versions.insert(it.key(), it.value().version);
+    }
+
+    return versions;
+}
+
+
+auto fake::label(int version) -> QString
+{
+    return QString("v%1").arg(version);
+}
+
+
+auto fake::probesStarted(QString const& devicePath) -> int
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+    return Fake_history.value(devicePath).probesStarted;
+}
+
+
+auto fake::maxConcurrentProbes(QString const& devicePath) -> int
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+    return Fake_history.value(devicePath).maxConcurrentProbes;
+}
+
+
+auto devlib::native::makeChangeMonitor(void)
+    -> std::unique_ptr<ChangeMonitor>
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+
+    auto monitor = std::make_unique<FakeMonitor>();
+    monitor->received = Fake_events.size();
+
+    return monitor;
+}
+
+
+auto devlib::native::pollChanges(ChangeMonitor* monitor)
+    -> std::vector<ChangeEvent>
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+
+    auto fakeMonitor = static_cast<FakeMonitor*>(monitor);
+    auto events = std::vector<ChangeEvent>(Fake_events.cbegin() + fakeMonitor->received,
+                                           Fake_events.cend());
+    fakeMonitor->received = Fake_events.size();
+
+    return events;
+}
+
+
+auto devlib::native::requestUsbDeviceList(DiscoveryBackend backend)
+    -> std::vector<std::tuple<int, int, QString, QString>>
+{
+    Q_UNUSED(backend);
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+
+    auto devices = std::vector<std::tuple<int, int, QString, QString>>();
+    for (auto it = Fake_devices.cbegin(); it != Fake_devices.cend(); ++it) {
+        devices.emplace_back(0x0781, 0x5567, it.key(), it.value().usbPortPath);
+    }
+
+    return devices;
+}
+
+
+auto devlib::native::devicePartitions(QString const& deviceName)
+    -> std::vector<PartitionInfo>
+{
+    std::unique_lock<std::mutex> lock(Fake_mutex);
+
+    if (!Fake_devices.contains(deviceName)) {
+        return {};
+    }
+
+    // read the table first, then maybe hang, as a slow stick would
+    auto version = Fake_devices[deviceName].version;
+    auto& history = Fake_history[deviceName];
+    history.probesStarted++;
+    history.probesRunning++;
+    history.maxConcurrentProbes = qMax(history.maxConcurrentProbes, history.probesRunning);
+
+    Fake_released.wait(lock, [&deviceName] () {
+        return !Fake_devices.value(deviceName).hung;
+    });
+    Fake_history[deviceName].probesRunning--;
+
+    auto partitions = std::vector<PartitionInfo>();
+    for (auto number = 1; number <= 2; number++) {
+        auto partition = PartitionInfo();
+        partition.filePath = partitionPath(deviceName, number);
+        partition.label = fake::label(version);
+        partition.fsType = "vfat";
+        partitions.push_back(partition);
+    }
+
+    return partitions;
+}
+
+
+auto devlib::native::mntptsForPartition(QString const& devFilePath)
+    -> std::vector<std::pair<QString, QString>>
+{
+    std::lock_guard<std::mutex> lock(Fake_mutex);
+    auto mntpts = std::vector<std::pair<QString, QString>>();
+
+    for (auto it = Fake_devices.cbegin(); it != Fake_devices.cend(); ++it) {
+        if (devFilePath == partitionPath(it.key(), 1)) {
+            mntpts.emplace_back(mountpointOf(devFilePath), devFilePath);
+        }
+    }
+
+    return mntpts;
+}
+
+
+auto devlib::native::serveLocalSocket(QString const& path,
+                                      std::function<QByteArray(QByteArray const&)> respond)
+    -> std::unique_ptr<LocalServer>
+{
+    Q_UNUSED(path);
+    Q_UNUSED(respond);
+    return nullptr;
+}
@@ -0,0 +1,32 @@
+#ifndef FAKE_NATIVE_H
+#define FAKE_NATIVE_H
+
+#include <QtCore>
+
+// In-memory system behind the devlib::native functions DeviceRegistry
+// uses, linked in place of the platform layer. State changes first and
+// its events are queued afterwards, in the order the kernel and udev
+// deliver them. Every device has two partitions labelled with the
+// version of its partition table, the first one is mounted.
+namespace fake {
+    void reset(void);
+
+    void plug(QString const& devicePath, QString const& usbPortPath);
+    void unplug(QString const& devicePath);
+
+    // partition table rewritten: the version goes up
+    void change(QString const& devicePath);
+
+    // partitions probes of the device block until it is released
+    void hang(QString const& devicePath);
+    void release(QString const& devicePath);
+
+    auto devices(void) -> QMap<QString, int>; // path, partition table version
+    auto label(int version) -> QString;
+
+    auto probesStarted(QString const& devicePath) -> int;
+    // most partitions probes of the device that ever ran at once
+    auto maxConcurrentProbes(QString const& devicePath) -> int;
+}
+
+#endif // FAKE_NATIVE_H
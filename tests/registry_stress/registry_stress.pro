@@ -0,0 +1,37 @@
+QT -= gui
+QT += testlib
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+TARGET = tst_registrystress
+
+# DeviceRegistry is built from source against the in-memory fake of
+# the native layer instead of linking libdevlib
+SOURCES += \
+    tst_registrystress.cpp \
+    fake_native.cpp \
+    $$PWD/../../devlib/impl/DeviceRegistry.cpp \
+    $$PWD/../../devlib/impl/MetricsRegistry.cpp \
+    $$PWD/../../devlib/impl/ProbeQueue.cpp \
+    $$PWD/../../devlib/StorageSnapshot.cpp \
+    $$PWD/../../devlib/UsbTopology.cpp \
+
+HEADERS += \
+    fake_native.h \
+
+INCLUDEPATH += $$PWD/../../devlib
+DEPENDPATH += $$PWD/../../devlib
+
+# races are what this test looks for: always built with ThreadSanitizer,
+# as DEVLIB_WITH_TSAN builds the library
+unix {
+    CONFIG += DEVLIB_WITH_TSAN
+}
+
+DEVLIB_WITH_TSAN {
+    QMAKE_CXXFLAGS += -fsanitize=thread -fno-omit-frame-pointer
+    QMAKE_LFLAGS += -fsanitize=thread
+}
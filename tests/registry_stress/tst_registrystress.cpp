@@ -0,0 +1,341 @@
+#include "fake_native.h"
+
+#include "impl/DeviceRegistry.h"
+
+#include <QtTest>
+
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace {
+    using namespace std::chrono_literals;
+    using devlib::impl::DeviceRegistry;
+
+    constexpr auto Stress_devices = 8;
+    constexpr auto Stress_readers = 4;
+    constexpr auto Stress_readerIterations = 300;
+    constexpr auto Stress_hotplugIterations = 500;
+
+
+    auto devicePath(int index) {
+        return QString("/dev/sd%1").arg(QChar('a' + index));
+    }
+
+
+    auto portPath(int index) {
+        return QString("1-%1").arg(index + 1);
+    }
+
+
+    // violations found by worker threads, QVERIFY only works in the
+    // test thread
+    class Problems
+    {
+    public:
+        void expect(bool ok, QString const& what) {
+            if (!ok) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _found.append(what);
+            }
+        }
+
+        auto found(void) -> QString {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _found.mid(0, 20).join('\n');
+        }
+
+    private:
+        std::mutex _mutex;
+        QStringList _found;
+    };
+
+
+    auto recordOf(devlib::StorageSnapshot const& snapshot, QString const& path)
+        -> devlib::DeviceRecord const*
+    {
+        for (auto const& device : snapshot.devices()) {
+            if (device.filePath == path) {
+                return &device;
+            }
+        }
+        return nullptr;
+    }
+
+
+    // label of the partitions as snapshot() probed them, empty if the
+    // probe timed out
+    auto probedLabel(DeviceRegistry& registry, QString const& path) -> QString {
+        auto snapshot = registry.snapshot();
+        auto device = recordOf(snapshot, path);
+
+        if (device == nullptr || device->probeTimedOut
+                || snapshot.partitions(*device).empty()) {
+            return QString();
+        }
+        return snapshot.partitions(*device)[0].label;
+    }
+
+
+    void checkPartitions(Problems& problems, QString const& devicePath,
+                         std::vector<DeviceRegistry::PartitionEntry> const& partitions)
+    {
+        for (auto const& partition : partitions) {
+            problems.expect(partition.filePath.startsWith(devicePath),
+                            partition.filePath + " listed under " + devicePath);
+            problems.expect(partition.label == partitions.front().label,
+                            devicePath + " mixes two partition tables");
+        }
+    }
+
+
+    void checkSnapshot(Problems& problems, devlib::StorageSnapshot const& snapshot) {
+        auto seen = QSet<QString>();
+
+        for (auto const& device : snapshot.devices()) {
+            problems.expect(!seen.contains(device.filePath),
+                            device.filePath + " listed twice");
+            seen.insert(device.filePath);
+
+            auto partitions = snapshot.partitions(device);
+            problems.expect(!device.probeTimedOut || partitions.empty(),
+                            device.filePath + " timed out with partitions");
+
+            auto labels = QSet<QString>();
+            for (auto const& partition : partitions) {
+                labels.insert(partition.label);
+                problems.expect(partition.filePath.startsWith(device.filePath),
+                                partition.filePath + " listed under " + device.filePath);
+
+                for (auto const& mntpt : snapshot.mountpoints(partition)) {
+                    problems.expect(mntpt.device == partition.filePath,
+                                    mntpt.fsPath + " listed under " + partition.filePath);
+                }
+            }
+            problems.expect(labels.size() <= 1,
+                            device.filePath + " mixes two partition tables");
+        }
+    }
+
+
+    void checkTopology(Problems& problems, devlib::UsbTopology const& topology) {
+        for (auto index = 0; index < Stress_devices; index++) {
+            auto device = topology.deviceAt(portPath(index));
+            if (!device.isEmpty()) {
+                problems.expect(topology.portPathOf(device) == portPath(index),
+                                device + " is at two ports");
+            }
+        }
+    }
+}
+
+
+class RegistryStressTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init(void);
+    void cleanup(void);
+
+    void hungProbeDoesNotBlockSnapshot(void);
+    void staleProbeIsNotDuplicated(void);
+    void concurrentHotplugAndEnumeration(void);
+};
+
+
+void RegistryStressTest::init(void)
+{
+    fake::reset();
+}
+
+
+void RegistryStressTest::cleanup(void)
+{
+    // hung probes return, their threads finish on their own
+    fake::reset();
+}
+
+
+void RegistryStressTest::hungProbeDoesNotBlockSnapshot(void)
+{
+    fake::plug(devicePath(0), portPath(0));
+    fake::plug(devicePath(1), portPath(1));
+    fake::hang(devicePath(0));
+
+    DeviceRegistry registry;
+    registry.setProbeLimits(1, 200ms);
+
+    QElapsedTimer timer;
+    timer.start();
+    auto snapshot = registry.snapshot();
+
+    QVERIFY(timer.elapsed() < 2000);
+    QCOMPARE(snapshot.devices().size(), std::size_t(2));
+    QVERIFY(recordOf(snapshot, devicePath(0))->probeTimedOut);
+
+    // the hung probe no longer holds the only slot, and later
+    // snapshots do not wait for it again
+    auto versions = fake::devices();
+    timer.restart();
+    QCOMPARE(probedLabel(registry, devicePath(1)), fake::label(versions.value(devicePath(1))));
+    QCOMPARE(probedLabel(registry, devicePath(0)), QString());
+    QVERIFY(timer.elapsed() < 400);
+    QCOMPARE(fake::probesStarted(devicePath(0)), 1);
+
+    // its late answer is taken as it is
+    fake::release(devicePath(0));
+    QTRY_COMPARE(probedLabel(registry, devicePath(0)), fake::label(versions.value(devicePath(0))));
+    QCOMPARE(fake::probesStarted(devicePath(0)), 1);
+}
+
+
+void RegistryStressTest::staleProbeIsNotDuplicated(void)
+{
+    fake::plug(devicePath(0), portPath(0));
+    fake::hang(devicePath(0));
+
+    DeviceRegistry registry;
+    registry.setProbeLimits(2, 100ms);
+
+    QCOMPARE(probedLabel(registry, devicePath(0)), QString());
+
+    // the event makes the running probe stale, it is not started again
+    // while the first one still runs
+    fake::change(devicePath(0));
+    QCOMPARE(probedLabel(registry, devicePath(0)), QString());
+    QCOMPARE(probedLabel(registry, devicePath(0)), QString());
+    QCOMPARE(fake::probesStarted(devicePath(0)), 1);
+
+    // once it returns, its outdated result is dropped for a fresh probe
+    fake::release(devicePath(0));
+    auto current = fake::label(fake::devices().value(devicePath(0)));
+    QTRY_COMPARE(probedLabel(registry, devicePath(0)), current);
+
+    QCOMPARE(fake::probesStarted(devicePath(0)), 2);
+    QCOMPARE(fake::maxConcurrentProbes(devicePath(0)), 1);
+}
+
+
+void RegistryStressTest::concurrentHotplugAndEnumeration(void)
+{
+    for (auto index = 0; index < Stress_devices; index += 2) {
+        fake::plug(devicePath(index), portPath(index));
+    }
+
+    DeviceRegistry registry;
+    registry.setProbeLimits(4, 5000ms);
+    Problems problems;
+
+    auto reader = [&registry, &problems] (unsigned seed) {
+        auto random = std::mt19937(seed);
+
+        for (auto i = 0; i < Stress_readerIterations; i++) {
+            auto path = devicePath(int(random() % Stress_devices));
+
+            switch (random() % 5) {
+            case 0:
+                checkSnapshot(problems, registry.snapshot());
+                break;
+
+            case 1: {
+                auto devices = registry.devices();
+                auto paths = QSet<QString>();
+                for (auto const& device : *devices) {
+                    paths.insert(std::get<2>(device));
+                }
+                problems.expect(int(devices->size()) == paths.size(), "device listed twice");
+                break;
+            }
+
+            case 2:
+                checkPartitions(problems, path, *registry.partitions(path));
+                break;
+
+            case 3:
+                for (auto const& mntpt : *registry.mountpoints(path + "1")) {
+                    problems.expect(mntpt.second == path + "1",
+                                    mntpt.first + " listed under " + path + "1");
+                }
+                break;
+
+            default:
+                checkTopology(problems, registry.usbTopology());
+                break;
+            }
+        }
+    };
+
+    auto hotplug = [&registry] (unsigned seed) {
+        auto random = std::mt19937(seed);
+
+        for (auto i = 0; i < Stress_hotplugIterations; i++) {
+            auto index = int(random() % Stress_devices);
+            auto path = devicePath(index);
+
+            if (!fake::devices().contains(path)) {
+                fake::plug(path, portPath(index));
+            } else if (random() % 2 == 0) {
+                fake::change(path);
+            } else {
+                fake::unplug(path);
+            }
+
+            if (i % 97 == 0) {
+                registry.rescan();
+            }
+            if (i % 131 == 0) {
+                registry.setProbeLimits(1 + int(random() % 4), 5000ms);
+            }
+        }
+    };
+
+    auto threads = std::vector<std::thread>();
+    for (auto i = 0; i < Stress_readers; i++) {
+        threads.emplace_back(reader, unsigned(i + 1));
+    }
+    threads.emplace_back(hotplug, 0u);
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    QVERIFY2(problems.found().isEmpty(), qPrintable(problems.found()));
+
+    // quiet now: every query reflects the final state
+    auto versions = fake::devices();
+    auto paths = QStringList();
+    for (auto const& device : *registry.devices()) {
+        paths.append(std::get<2>(device));
+    }
+    paths.sort();
+    QCOMPARE(paths, versions.keys());
+
+    auto snapshot = registry.snapshot();
+    auto topology = registry.usbTopology();
+    QCOMPARE(int(snapshot.devices().size()), versions.size());
+
+    for (auto it = versions.cbegin(); it != versions.cend(); ++it) {
+        auto device = recordOf(snapshot, it.key());
+        QVERIFY(device != nullptr);
+        QVERIFY(!device->probeTimedOut);
+
+        auto partitions = snapshot.partitions(*device);
+        QCOMPARE(partitions.size(), std::size_t(2));
+        QCOMPARE(partitions[0].label, fake::label(it.value()));
+        QCOMPARE(registry.partitions(it.key())->front().label, fake::label(it.value()));
+
+        auto mntpts = snapshot.mountpoints(partitions[0]);
+        QCOMPARE(mntpts.size(), std::size_t(1));
+        QCOMPARE(mntpts[0].fsPath, "/media/" + QFileInfo(partitions[0].filePath).fileName());
+
+        auto index = it.key().back().unicode() - 'a';
+        QCOMPARE(topology.portPathOf(it.key()), portPath(index));
+        QCOMPARE(topology.deviceAt(portPath(index)), it.key());
+    }
+}
+
+
+QTEST_GUILESS_MAIN(RegistryStressTest)
+
+#include "tst_registrystress.moc"
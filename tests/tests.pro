@@ -0,0 +1,5 @@
+TEMPLATE=subdirs
+
+SUBDIRS += \
+   capacity_probe \
+   registry_stress \